@@ -0,0 +1,161 @@
+# add_example(<source> <standard>)
+#
+# Adds <source> as the executable cpp<standard>_<name>, written to
+# <build>/cpp<standard>/<name>. Extra flags come from the example's
+# "// Build:" comment (-O, -m, -f options, -l libraries, -rdynamic), so the
+# comment stays the single place that says how an example is built.
+#
+# Each example is first probed with try_compile; one that fails (missing
+# header such as <generator>, a language feature the compiler lacks, a
+# missing library) is skipped instead of breaking the build. Probe results are
+# cached per source contents and compiler, so reconfiguring is cheap.
+
+# Libraries some standard headers need with libstdc++, tried in order when an
+# example fails to link without them.
+set(EXAMPLES_HEADER_LIBRARIES
+    "stacktrace=stdc++exp"
+    "stacktrace=stdc++_libbacktrace"
+    "execution=tbb")
+
+# C library wrappers stay #included in module mode: import std; exports none
+# of their macros (assert, stdout, INT_MAX, errno, ...).
+set(EXAMPLES_C_HEADERS
+    cassert cctype cerrno cfenv cfloat cinttypes climits clocale cmath csetjmp csignal cstdarg cstddef cstdint
+    cstdio cstdlib cstring ctime cuchar cwchar cwctype version)
+
+function(_example_build_flags text out_compile out_link out_libraries)
+    set(compile_options)
+    set(link_options)
+    set(libraries)
+    if(CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang" AND text MATCHES "// Build: ([^\n(]*)")
+        separate_arguments(args UNIX_COMMAND "${CMAKE_MATCH_1}")
+        foreach(arg IN LISTS args)
+            if(arg MATCHES "^-l(.+)$")
+                list(APPEND libraries ${CMAKE_MATCH_1})
+            elseif(arg MATCHES "^-(rdynamic|pthread)$")
+                list(APPEND link_options ${arg})
+            elseif(arg MATCHES "^-(O.*|m.+|f.+)$")
+                list(APPEND compile_options ${arg})
+            endif()
+        endforeach()
+    endif()
+    set(${out_compile} ${compile_options} PARENT_SCOPE)
+    set(${out_link} ${link_options} PARENT_SCOPE)
+    set(${out_libraries} ${libraries} PARENT_SCOPE)
+endfunction()
+
+# Sets <out_ok> and <out_libraries> (the Build-line libraries plus any header
+# library the example turned out to need).
+function(_example_probe target source standard text compile_options link_options libraries out_ok out_libraries)
+    string(SHA1 key "${text}${standard}${compile_options}${CMAKE_CXX_COMPILER_ID}${CMAKE_CXX_COMPILER_VERSION}")
+    if(DEFINED CACHE{EXAMPLE_PROBE_${target}})
+        set(cached "${EXAMPLE_PROBE_${target}}")
+        list(POP_FRONT cached cached_key cached_ok)
+        if(cached_key STREQUAL key)
+            set(${out_ok} ${cached_ok} PARENT_SCOPE)
+            set(${out_libraries} ${cached} PARENT_SCOPE)
+            return()
+        endif()
+    endif()
+
+    # "-" is the attempt with the Build-line libraries alone.
+    set(extras -)
+    foreach(entry IN LISTS EXAMPLES_HEADER_LIBRARIES)
+        string(REPLACE "=" ";" entry "${entry}")
+        list(GET entry 0 header)
+        list(GET entry 1 library)
+        if(text MATCHES "#include <${header}>")
+            list(APPEND extras ${library})
+        endif()
+    endforeach()
+
+    foreach(extra IN LISTS extras)
+        set(attempt_libraries ${libraries})
+        if(NOT extra STREQUAL "-")
+            list(APPEND attempt_libraries ${extra})
+        endif()
+        try_compile(ok ${CMAKE_BINARY_DIR}/probes/${target} ${source}
+            COMPILE_DEFINITIONS ${compile_options}
+            LINK_OPTIONS ${link_options}
+            LINK_LIBRARIES ${attempt_libraries} Threads::Threads
+            CXX_STANDARD ${standard}
+            CXX_STANDARD_REQUIRED ON
+            CXX_EXTENSIONS OFF
+            OUTPUT_VARIABLE log)
+        if(ok OR NOT log MATCHES "undefined reference|unresolved external|cannot find -l|library not found")
+            break()
+        endif()
+    endforeach()
+    if(NOT ok)
+        set(attempt_libraries ${libraries})
+    endif()
+
+    set(EXAMPLE_PROBE_${target} "${key};${ok};${attempt_libraries}" CACHE INTERNAL "")
+    set(${out_ok} ${ok} PARENT_SCOPE)
+    set(${out_libraries} ${attempt_libraries} PARENT_SCOPE)
+endfunction()
+
+# Writes the import std; form of <source> to <out_source>: standard library
+# #includes are dropped, the C wrappers are hoisted above the import, and a
+# #line directive keeps diagnostics pointing at the original file.
+function(_example_module_source source out_source)
+    file(READ ${source} text)
+    set(hoisted)
+    set(body "")
+    string(REPLACE ";" "\\;" text "${text}")
+    string(REPLACE "\n" ";" lines "${text}")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^#include <([a-z_]+)>[ \t]*$")
+            if(CMAKE_MATCH_1 IN_LIST EXAMPLES_C_HEADERS)
+                list(APPEND hoisted "#include <${CMAKE_MATCH_1}>")
+            endif()
+            set(line "")
+        endif()
+        string(APPEND body "${line}\n")
+    endforeach()
+    list(REMOVE_DUPLICATES hoisted)
+    list(JOIN hoisted "\n" hoisted)
+    file(WRITE ${out_source}.tmp "${hoisted}\nimport std;\n#line 1 \"${source}\"\n${body}")
+    # Only touch the generated file when it changes, so reconfiguring does not
+    # rebuild every example.
+    file(COPY_FILE ${out_source}.tmp ${out_source} ONLY_IF_DIFFERENT)
+    file(REMOVE ${out_source}.tmp)
+endfunction()
+
+function(add_example source standard)
+    get_filename_component(name ${source} NAME_WE)
+    set(target cpp${standard}_${name})
+    file(READ ${source} text)
+    if(NOT text MATCHES "(^|\n)int main\\(")
+        return()  # module interface units and fragments
+    endif()
+
+    _example_build_flags("${text}" compile_options link_options libraries)
+    _example_probe(${target} ${source} ${standard} "${text}" "${compile_options}" "${link_options}" "${libraries}"
+        ok libraries)
+    if(NOT ok)
+        set_property(GLOBAL APPEND PROPERTY EXAMPLES_SKIPPED cpp${standard}/${name})
+        return()
+    endif()
+
+    if(EXAMPLES_MODULES AND standard GREATER_EQUAL 20)
+        set(module_source ${CMAKE_CURRENT_BINARY_DIR}/import_std/cpp${standard}/${name}.cpp)
+        _example_module_source(${source} ${module_source})
+        set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${source})
+        add_executable(${target} ${module_source})
+        # CMake only provides import std; to C++23 targets.
+        set_target_properties(${target} PROPERTIES CXX_STANDARD 23 CXX_MODULE_STD ON)
+    else()
+        add_executable(${target} ${source})
+        set_target_properties(${target} PROPERTIES CXX_STANDARD ${standard})
+    endif()
+    set_target_properties(${target} PROPERTIES
+        CXX_STANDARD_REQUIRED ON
+        CXX_EXTENSIONS OFF
+        OUTPUT_NAME ${name}
+        RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/cpp${standard})
+    target_compile_options(${target} PRIVATE ${compile_options})
+    target_link_options(${target} PRIVATE ${link_options})
+    target_link_libraries(${target} PRIVATE ${libraries} Threads::Threads)
+    set_property(GLOBAL APPEND PROPERTY EXAMPLES_BUILT cpp${standard}/${name})
+endfunction()
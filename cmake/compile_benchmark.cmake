@@ -0,0 +1,106 @@
+# Times the example build with standard headers and with import std;.
+#
+#   cmake --build build --target compile_benchmark
+#
+# or directly:
+#
+#   cmake -DSOURCE_DIR=. -DWORK_DIR=/tmp/bench -P cmake/compile_benchmark.cmake
+#
+# The sources are copied into WORK_DIR first, so that the incremental build
+# can touch an example without changing the source tree. For each mode,
+# configures a fresh tree and reports the cold build (every example, plus the
+# std module in module mode) and an incremental build after touching one
+# example. Configure time, which includes the availability probes, is
+# reported separately. Module mode is skipped when the toolchain cannot
+# configure it.
+cmake_minimum_required(VERSION 3.23)
+
+if(NOT SOURCE_DIR OR NOT WORK_DIR)
+    message(FATAL_ERROR "usage: cmake -DSOURCE_DIR=<repo> -DWORK_DIR=<dir> -P compile_benchmark.cmake")
+endif()
+if(NOT GENERATOR)
+    find_program(NINJA ninja)
+    if(NINJA)
+        set(GENERATOR Ninja)
+    else()
+        set(GENERATOR "Unix Makefiles")
+    endif()
+endif()
+cmake_host_system_information(RESULT jobs QUERY NUMBER_OF_LOGICAL_CORES)
+
+set(source_copy ${WORK_DIR}/src)
+file(REMOVE_RECURSE ${source_copy})
+file(COPY ${SOURCE_DIR}/CMakeLists.txt ${SOURCE_DIR}/cmake DESTINATION ${source_copy})
+foreach(standard 11 14 17 20 23)
+    file(COPY ${SOURCE_DIR}/cpp${standard} DESTINATION ${source_copy} FILES_MATCHING PATTERN "*.cpp")
+endforeach()
+
+# The incremental build touches this example.
+set(touched ${source_copy}/cpp23/enum_containers.cpp)
+
+function(now out)
+    string(TIMESTAMP micros "%s%f" UTC)
+    math(EXPR ms "${micros} / 1000")
+    set(${out} ${ms} PARENT_SCOPE)
+endfunction()
+
+# Runs the command and sets <out> to the elapsed seconds with millisecond
+# precision, or to "" (and `errors` to its stderr) when it fails.
+function(timed out)
+    now(start)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE errors)
+    now(stop)
+    if(NOT result EQUAL 0)
+        set(${out} "" PARENT_SCOPE)
+        set(errors "${errors}" PARENT_SCOPE)
+        return()
+    endif()
+    math(EXPR ms "${stop} - ${start}")
+    math(EXPR whole "${ms} / 1000")
+    math(EXPR frac "${ms} % 1000")
+    string(LENGTH "${frac}" digits)
+    if(digits EQUAL 1)
+        set(frac "00${frac}")
+    elseif(digits EQUAL 2)
+        set(frac "0${frac}")
+    endif()
+    set(${out} "${whole}.${frac}" PARENT_SCOPE)
+endfunction()
+
+set(report "")
+foreach(mode headers modules)
+    set(dir ${WORK_DIR}/${mode})
+    file(REMOVE_RECURSE ${dir})
+    set(configure_args -S ${source_copy} -B ${dir} -G ${GENERATOR} -DCMAKE_BUILD_TYPE=Release)
+    if(CXX_COMPILER)
+        list(APPEND configure_args -DCMAKE_CXX_COMPILER=${CXX_COMPILER})
+    endif()
+    if(mode STREQUAL "modules")
+        list(APPEND configure_args -DEXAMPLES_MODULES=ON)
+    endif()
+
+    message(STATUS "[${mode}] configuring")
+    timed(configure ${CMAKE_COMMAND} ${configure_args})
+    if(configure STREQUAL "")
+        message(STATUS "[${mode}] cannot configure with this toolchain, skipped:\n${errors}")
+        string(APPEND report "${mode}: not supported by this toolchain\n")
+        continue()
+    endif()
+
+    message(STATUS "[${mode}] cold build")
+    timed(cold ${CMAKE_COMMAND} --build ${dir} -j ${jobs})
+    if(cold STREQUAL "")
+        message(FATAL_ERROR "[${mode}] build failed:\n${errors}")
+    endif()
+
+    message(STATUS "[${mode}] incremental build")
+    file(TOUCH ${touched})
+    timed(incremental ${CMAKE_COMMAND} --build ${dir} -j ${jobs})
+    if(incremental STREQUAL "")
+        message(FATAL_ERROR "[${mode}] incremental build failed:\n${errors}")
+    endif()
+
+    string(APPEND report "${mode}: configure ${configure} s, cold build ${cold} s, incremental build ${incremental} s\n")
+endforeach()
+
+message("Build times with ${jobs} jobs (${GENERATOR}):\n${report}")
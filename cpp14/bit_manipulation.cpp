@@ -0,0 +1,305 @@
+// Bit-manipulation toolkit: popcount, count of leading/trailing zeros and
+// BMI2 pdep/pext, each with a portable fallback, plus packed_array<Width>,
+// an array of Width-bit integers (1-64) stored back to back.
+// Bulk pack and unpack use pext/pdep to move two values per instruction; for
+// widths up to 25 bits an AVX2 path unpacks eight values at once.
+// Note: pdep/pext are microcoded and slow on AMD before Zen 3.
+// Build: g++ -std=c++14 -O2 -march=native bit_manipulation.cpp
+// Usage: ./a.out [values]   (default 4'000'000)
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if defined(__BMI2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace bits {
+
+inline int popcount(std::uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for (; x != 0; x &= x - 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline int countr_zero(std::uint64_t x) {
+#if defined(__GNUC__)
+    return x == 0 ? 64 : __builtin_ctzll(x);
+#else
+    int n = 0;
+    for (; n < 64 && !(x & 1); x >>= 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline int countl_zero(std::uint64_t x) {
+#if defined(__GNUC__)
+    return x == 0 ? 64 : __builtin_clzll(x);
+#else
+    int n = 0;
+    for (std::uint64_t bit = std::uint64_t{1} << 63; n < 64 && !(x & bit); bit >>= 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Scatters the low bits of src to the set bit positions of mask.
+inline std::uint64_t pdep(std::uint64_t src, std::uint64_t mask) {
+#if defined(__BMI2__)
+    return _pdep_u64(src, mask);
+#else
+    std::uint64_t out = 0;
+    for (std::uint64_t bit = 1; mask != 0; bit <<= 1) {
+        if (src & bit) {
+            out |= mask & (~mask + 1);
+        }
+        mask &= mask - 1;
+    }
+    return out;
+#endif
+}
+
+// Gathers the bits of src at the set bit positions of mask into the low bits.
+inline std::uint64_t pext(std::uint64_t src, std::uint64_t mask) {
+#if defined(__BMI2__)
+    return _pext_u64(src, mask);
+#else
+    std::uint64_t out = 0;
+    for (std::uint64_t bit = 1; mask != 0; bit <<= 1) {
+        if (src & mask & (~mask + 1)) {
+            out |= bit;
+        }
+        mask &= mask - 1;
+    }
+    return out;
+#endif
+}
+
+constexpr std::uint64_t low_mask(unsigned width) { return width >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1; }
+
+} // namespace bits
+
+template <unsigned Width>
+class packed_array {
+    static_assert(Width >= 1 && Width <= 64, "Width must be 1-64 bits");
+
+public:
+    using value_type = typename std::conditional<(Width <= 32), std::uint32_t, std::uint64_t>::type;
+
+    // Four spare words, so the two-word and 16-byte reads of the fast paths
+    // never run off the end.
+    explicit packed_array(std::size_t n) : size_(n), words_((n * Width + 63) / 64 + 4) {}
+
+    std::size_t size() const { return size_; }
+
+    value_type get(std::size_t i) const { return static_cast<value_type>(read(i * Width, Width)); }
+
+    void set(std::size_t i, value_type value) {
+        std::size_t bit = i * Width;
+        std::size_t w = bit / 64;
+        unsigned shift = bit % 64;
+        std::uint64_t v = value & bits::low_mask(Width);
+        words_[w] = (words_[w] & ~(bits::low_mask(Width) << shift)) | (v << shift);
+        if (shift + Width > 64) {
+            unsigned spill = shift + Width - 64;
+            words_[w + 1] = (words_[w + 1] & ~bits::low_mask(spill)) | (v >> (64 - shift));
+        }
+    }
+
+    // Reference loops: one shift-and-mask per value.
+    void pack_naive(const value_type* in) {
+        for (std::size_t i = 0; i < size_; ++i) {
+            set(i, in[i]);
+        }
+    }
+    void unpack_naive(value_type* out) const {
+        for (std::size_t i = 0; i < size_; ++i) {
+            out[i] = get(i);
+        }
+    }
+
+    // Two 32-bit lanes per pext: the low Width bits of each lane are squeezed
+    // together and appended to the bit stream.
+    void pack(const value_type* in) {
+        std::fill(words_.begin(), words_.end(), 0);
+        std::size_t i = 0;
+        std::size_t bit = 0;
+        if (Width <= 32) {
+            const std::uint64_t lanes_mask = bits::low_mask(Width) | bits::low_mask(Width) << 32;
+            for (; i + 2 <= size_; i += 2, bit += 2 * Width) {
+                std::uint64_t lanes;
+                std::memcpy(&lanes, in + i, 8);
+                append(bit, bits::pext(lanes, lanes_mask));
+            }
+        }
+        for (; i < size_; ++i, bit += Width) {
+            append(bit, in[i] & bits::low_mask(Width));
+        }
+    }
+
+    // The inverse: 2 * Width bits are spread into two 32-bit lanes by pdep.
+    void unpack(value_type* out) const {
+        std::size_t i = 0;
+        if (Width <= 32) {
+            const std::uint64_t lanes_mask = bits::low_mask(Width) | bits::low_mask(Width) << 32;
+            for (; i + 2 <= size_; i += 2) {
+                std::uint64_t lanes = bits::pdep(read(i * Width, 2 * Width), lanes_mask);
+                std::memcpy(out + i, &lanes, 8);
+            }
+        }
+        for (; i < size_; ++i) {
+            out[i] = get(i);
+        }
+    }
+
+#if defined(__AVX2__)
+    // Eight values per iteration for Width <= 25. Eight values span exactly
+    // Width bytes, so each group starts on a byte boundary; value j starts in
+    // byte j*Width/8 at bit j*Width%8. Each 128-bit half is loaded from where
+    // its four values start, pshufb moves each value's four bytes into its
+    // lane, and a variable shift and mask finish the job.
+    void unpack_avx2(value_type* out) const {
+        static_assert(Width <= 25, "a value plus its bit offset must fit in 32 bits");
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(words_.data());
+        const std::size_t high_offset = 4 * Width / 8;
+        alignas(32) std::uint8_t shuffle[32];
+        alignas(32) std::uint32_t shifts[8];
+        for (unsigned j = 0; j < 8; ++j) {
+            std::size_t start = j * Width / 8 - (j < 4 ? 0 : high_offset);
+            for (unsigned b = 0; b < 4; ++b) {
+                shuffle[4 * j + b] = static_cast<std::uint8_t>(start + b);
+            }
+            shifts[j] = j * Width % 8;
+        }
+        const __m256i control = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffle));
+        const __m256i shift = _mm256_load_si256(reinterpret_cast<const __m256i*>(shifts));
+        const __m256i mask = _mm256_set1_epi32(static_cast<int>(bits::low_mask(Width)));
+
+        std::size_t i = 0;
+        for (; i + 8 <= size_; i += 8) {
+            const std::uint8_t* group = bytes + i / 8 * Width;
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group + high_offset));
+            __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+            v = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(v, control), shift), mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        }
+        for (; i < size_; ++i) {
+            out[i] = get(i);
+        }
+    }
+#endif
+
+private:
+    // Reads up to 64 bits starting at any bit position.
+    std::uint64_t read(std::size_t bit, unsigned width) const {
+        std::size_t w = bit / 64;
+        unsigned shift = bit % 64;
+        std::uint64_t value = words_[w] >> shift;
+        if (shift != 0) {
+            value |= words_[w + 1] << (64 - shift);
+        }
+        return value & bits::low_mask(width);
+    }
+
+    // ORs value in at bit; the destination bits must be zero.
+    void append(std::size_t bit, std::uint64_t value) {
+        std::size_t w = bit / 64;
+        unsigned shift = bit % 64;
+        words_[w] |= value << shift;
+        if (shift != 0) {
+            words_[w + 1] |= value >> (64 - shift);
+        }
+    }
+
+    std::size_t size_;
+    std::vector<std::uint64_t> words_;
+};
+
+template <typename F>
+double gigabytes_per_second(std::size_t bytes, int repeats, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        f();
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(bytes) * repeats / s * 1e-9;
+}
+
+#if defined(__AVX2__)
+template <unsigned Width, typename Vector>
+void unpack_avx2_if_narrow(const packed_array<Width>& packed, Vector& out, std::size_t bytes, int repeats, std::true_type) {
+    std::cout << ", avx2 " << gigabytes_per_second(bytes, repeats, [&] { packed.unpack_avx2(out.data()); });
+}
+
+template <unsigned Width, typename Vector>
+void unpack_avx2_if_narrow(const packed_array<Width>&, Vector&, std::size_t, int, std::false_type) {}
+#endif
+
+template <unsigned Width>
+void benchmark(std::size_t n, int repeats) {
+    using value_type = typename packed_array<Width>::value_type;
+    std::mt19937_64 gen(Width);
+    std::vector<value_type> in(n), out(n);
+    for (value_type& v : in) {
+        v = static_cast<value_type>(gen() & bits::low_mask(Width));
+    }
+    packed_array<Width> packed(n);
+    const std::size_t bytes = n * sizeof(value_type);  // throughput counts unpacked bytes
+
+    std::cout << "width " << Width << (Width < 10 ? " " : "") << "  pack: naive "
+              << gigabytes_per_second(bytes, repeats, [&] { packed.pack_naive(in.data()); }) << ", pext "
+              << gigabytes_per_second(bytes, repeats, [&] { packed.pack(in.data()); }) << " GB/s";
+
+    std::cout << "   unpack: naive " << gigabytes_per_second(bytes, repeats, [&] { packed.unpack_naive(out.data()); });
+    bool ok = out == in;
+    std::cout << ", pdep " << gigabytes_per_second(bytes, repeats, [&] { packed.unpack(out.data()); });
+    ok = ok && out == in;
+#if defined(__AVX2__)
+    unpack_avx2_if_narrow(packed, out, bytes, repeats, std::integral_constant<bool, (Width <= 25)>());
+    ok = ok && out == in;
+#endif
+    std::cout << " GB/s" << (ok ? "" : "  MISMATCH") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::stoull(argv[1]) : 4'000'000;
+
+    // First 32-bit word of an IPv4 header: version, IHL, DSCP, ECN, total length.
+    std::uint32_t word = 0x4500003c;
+    std::cout << "IPv4 version " << (word >> 28) << ", IHL " << ((word >> 24) & 0xf) << ", total length "
+              << bits::pext(word, 0xffff) << ", version+IHL via pext 0x" << std::hex
+              << bits::pext(word, 0xff000000) << std::dec << std::endl;
+    std::cout << "popcount(0b1011'0110) = " << bits::popcount(0b1011'0110) << ", countr_zero(0b1000) = "
+              << bits::countr_zero(0b1000) << ", countl_zero(1) = " << bits::countl_zero(1)
+              << ", pdep(0b101, 0b1110'0000) = " << bits::pdep(0b101, 0b1110'0000) << std::endl;
+
+#if !defined(__BMI2__)
+    std::cout << "(no BMI2: pdep/pext use the portable loops; build with -march=native)" << std::endl;
+#endif
+    const int repeats = 20;
+    benchmark<1>(n, repeats);
+    benchmark<3>(n, repeats);
+    benchmark<7>(n, repeats);
+    benchmark<12>(n, repeats);
+    benchmark<17>(n, repeats);
+    benchmark<25>(n, repeats);
+    benchmark<31>(n, repeats);
+    benchmark<48>(n, repeats);
+    benchmark<64>(n, repeats);
+    return 0;
+}
@@ -0,0 +1,540 @@
+// Awaitable counterparts of the synchronization primitives in concurrency.md:
+// std::counting_semaphore and std::mutex block the calling OS thread, so a
+// coroutine that waits on them takes a whole worker thread out of the pool.
+// async_semaphore, async_mutex and channel<T> suspend the coroutine instead
+// and let the worker run other coroutines. Waiting coroutines are kept in an
+// intrusive lock-free queue (each node lives in the waiting coroutine's
+// frame, so waiting allocates nothing), and a woken coroutine is posted to
+// the thread pool rather than resumed inline by whoever released.
+//  - async_semaphore: a signed count; a negative count is the number of
+//    coroutines that are waiting or about to enqueue themselves;
+//  - async_mutex: a semaphore of one, handed directly to the next waiter,
+//    which may be held across co_await (std::mutex may not);
+//  - channel<T>: a bounded ring of slots between two semaphores counting free
+//    and filled slots.
+// The benchmark runs 100'000 coroutines on a pool of hardware threads and
+// compares them with one std::thread per client on the std primitives; the
+// times include creating the clients.
+// Build: g++ -std=c++20 -O2 -pthread async_sync_primitives.cpp
+// Usage: ./a.out [coroutines] [threads]   (default 100'000, 1'000)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <semaphore>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+
+class thread_pool {
+public:
+    explicit thread_pool(unsigned threads) {
+        for (unsigned t = 0; t < threads; ++t) {
+            workers_.emplace_back([this](std::stop_token st) { work(st); });
+        }
+    }
+
+    ~thread_pool() {
+        for (auto& w : workers_) {
+            w.request_stop();
+        }
+        cv_.notify_all();
+    }
+
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard lock{mx_};
+            queue_.push_back(h);
+        }
+        cv_.notify_one();
+    }
+
+    // co_await pool.schedule() continues the coroutine on a pool thread.
+    auto schedule() {
+        struct awaiter {
+            thread_pool& pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { pool.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this};
+    }
+
+private:
+    void work(std::stop_token st) {
+        std::unique_lock lock{mx_};
+        while (cv_.wait(lock, st, [this] { return !queue_.empty(); })) {
+            std::coroutine_handle<> h = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            h.resume();
+            lock.lock();
+        }
+    }
+
+    std::mutex mx_;
+    std::condition_variable_any cv_;
+    std::deque<std::coroutine_handle<>> queue_;
+    std::vector<std::jthread> workers_;
+};
+
+// A suspended coroutine in a waiter_queue.
+struct waiter {
+    std::atomic<waiter*> next{nullptr};
+    std::coroutine_handle<> handle;
+};
+
+// Intrusive multi-producer single-consumer queue (Vyukov): push is one atomic
+// exchange plus a store, pop is a few loads. pop() returns nullptr while the
+// queue is empty or a push is halfway done.
+class waiter_queue {
+public:
+    waiter_queue() : head_(&stub_), tail_(&stub_) {}
+
+    void push(waiter* w) {
+        w->next.store(nullptr, std::memory_order_relaxed);
+        waiter* prev = tail_.exchange(w, std::memory_order_acq_rel);
+        prev->next.store(w, std::memory_order_release);
+    }
+
+    waiter* pop() {
+        waiter* head = head_;
+        waiter* next = head->next.load(std::memory_order_acquire);
+        if (head == &stub_) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            head_ = head = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            head_ = next;
+            return head;
+        }
+        if (head != tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        push(&stub_);
+        next = head->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            head_ = next;
+            return head;
+        }
+        return nullptr;
+    }
+
+private:
+    waiter stub_;
+    waiter* head_;  // consumer only
+    std::atomic<waiter*> tail_;
+};
+
+class async_semaphore {
+public:
+    async_semaphore(thread_pool& executor, std::ptrdiff_t initial) : executor_(executor), count_(initial) {}
+
+    bool try_acquire() {
+        std::ptrdiff_t c = count_.load(std::memory_order_relaxed);
+        while (c > 0) {
+            if (count_.compare_exchange_weak(c, c - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    class acquire_awaiter : waiter {
+    public:
+        explicit acquire_awaiter(async_semaphore& s) : sem_(s) {}
+
+        bool await_ready() { return sem_.try_acquire(); }
+        // Nothing may touch the awaiter after push(): a releaser on another
+        // thread can resume the coroutine and free the frame right away.
+        bool await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            if (sem_.count_.fetch_sub(1, std::memory_order_acq_rel) > 0) {
+                return false;
+            }
+            sem_.waiters_.push(this);
+            return true;
+        }
+        void await_resume() const noexcept {}
+
+    private:
+        async_semaphore& sem_;
+    };
+
+    acquire_awaiter acquire() { return acquire_awaiter{*this}; }
+
+    void release() {
+        if (count_.fetch_add(1, std::memory_order_acq_rel) < 0) {
+            wake_one();
+        }
+    }
+
+private:
+    // The queue has one consumer at a time: the releaser that raises pending_
+    // from zero wakes waiters until it has served every releaser that came
+    // while it was busy. A waiter counted in count_ may not have pushed its
+    // node yet, so the waker yields until it appears. Woken coroutines are
+    // posted only after the last access to *this: one of them may be the
+    // semaphore's last user and destroy it.
+    void wake_one() {
+        if (pending_.fetch_add(1, std::memory_order_acq_rel) != 0) {
+            return;
+        }
+        thread_pool& executor = executor_;
+        std::vector<std::coroutine_handle<>> woken;
+        do {
+            waiter* w;
+            while ((w = waiters_.pop()) == nullptr) {
+                std::this_thread::yield();
+            }
+            woken.push_back(w->handle);
+        } while (pending_.fetch_sub(1, std::memory_order_acq_rel) != 1);
+        for (std::coroutine_handle<> h : woken) {
+            executor.post(h);
+        }
+    }
+
+    thread_pool& executor_;
+    std::atomic<std::ptrdiff_t> count_;
+    std::atomic<std::size_t> pending_{0};
+    waiter_queue waiters_;
+};
+
+// unlock() passes the mutex to the longest-waiting coroutine, if any, so a
+// coroutine that keeps locking cannot starve the others.
+class async_mutex {
+public:
+    explicit async_mutex(thread_pool& executor) : sem_(executor, 1) {}
+
+    bool try_lock() { return sem_.try_acquire(); }
+    async_semaphore::acquire_awaiter lock() { return sem_.acquire(); }
+    void unlock() { sem_.release(); }
+
+    // auto lock = co_await m.scoped_lock(); unlocks at the end of the scope.
+    auto scoped_lock() {
+        struct awaiter : async_semaphore::acquire_awaiter {
+            async_mutex& m;
+            awaiter(async_mutex& mutex) : acquire_awaiter(mutex.sem_), m(mutex) {}
+            std::unique_lock<async_mutex> await_resume() const noexcept { return {m, std::adopt_lock}; }
+        };
+        return awaiter{*this};
+    }
+
+private:
+    async_semaphore sem_;
+};
+
+// Slot i carries sequence number i + k * capacity while free for the k-th
+// lap, and one more once filled. The semaphores guarantee that a sender has a
+// free slot and a receiver a filled one; the ticket only picks which, and the
+// short wait on the sequence covers a peer that took the previous lap's
+// ticket for the slot but has not finished copying yet.
+template <typename T>
+class channel {
+public:
+    channel(thread_pool& executor, std::size_t capacity)
+        : free_(executor, static_cast<std::ptrdiff_t>(capacity)), filled_(executor, 0), slots_(capacity) {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    auto send(T value) {
+        struct awaiter : async_semaphore::acquire_awaiter {
+            channel& ch;
+            T value;
+            awaiter(channel& c, T v) : acquire_awaiter(c.free_), ch(c), value(std::move(v)) {}
+            void await_resume() { ch.put(std::move(value)); }
+        };
+        return awaiter{*this, std::move(value)};
+    }
+
+    auto receive() {
+        struct awaiter : async_semaphore::acquire_awaiter {
+            channel& ch;
+            explicit awaiter(channel& c) : acquire_awaiter(c.filled_), ch(c) {}
+            T await_resume() { return ch.take(); }
+        };
+        return awaiter{*this};
+    }
+
+private:
+    struct slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    void put(T value) {
+        std::size_t ticket = tail_.fetch_add(1, std::memory_order_relaxed);
+        slot& s = slots_[ticket % slots_.size()];
+        while (s.sequence.load(std::memory_order_acquire) != ticket) {
+            std::this_thread::yield();
+        }
+        s.value = std::move(value);
+        s.sequence.store(ticket + 1, std::memory_order_release);
+        filled_.release();
+    }
+
+    T take() {
+        std::size_t ticket = head_.fetch_add(1, std::memory_order_relaxed);
+        slot& s = slots_[ticket % slots_.size()];
+        while (s.sequence.load(std::memory_order_acquire) != ticket + 1) {
+            std::this_thread::yield();
+        }
+        T value = std::move(s.value);
+        s.sequence.store(ticket + slots_.size(), std::memory_order_release);
+        free_.release();
+        return value;
+    }
+
+    async_semaphore free_;
+    async_semaphore filled_;
+    std::vector<slot> slots_;
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+// The thread-blocking channel the coroutine one is compared with.
+template <typename T>
+class blocking_channel {
+public:
+    explicit blocking_channel(std::size_t capacity) : capacity_(capacity) {}
+
+    void send(T value) {
+        std::unique_lock lock{mx_};
+        not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+        items_.push_back(std::move(value));
+        not_empty_.notify_one();
+    }
+
+    T receive() {
+        std::unique_lock lock{mx_};
+        not_empty_.wait(lock, [this] { return !items_.empty(); });
+        T value = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return value;
+    }
+
+private:
+    std::mutex mx_;
+    std::condition_variable not_full_, not_empty_;
+    std::deque<T> items_;
+    std::size_t capacity_;
+};
+
+// Fire-and-forget coroutine that records the size of the largest frame.
+struct client {
+    struct promise_type {
+        client get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(std::size_t size) {
+            std::size_t largest = frame_bytes.load(std::memory_order_relaxed);
+            while (largest < size && !frame_bytes.compare_exchange_weak(largest, size, std::memory_order_relaxed)) {
+            }
+            return ::operator new(size);
+        }
+        static void operator delete(void* p) { ::operator delete(p); }
+    };
+    static inline std::atomic<std::size_t> frame_bytes{0};
+};
+
+constexpr int rounds = 4;            // critical sections per client
+constexpr std::ptrdiff_t permits = 64;  // concurrency the semaphore allows
+constexpr std::size_t capacity = 256;   // channel slots
+
+// Each critical section suspends while holding the mutex (a stand-in for an
+// awaited I/O call), which std::mutex could not survive.
+client mutex_client(thread_pool& pool, async_mutex& m, long& counter, std::latch& done) {
+    co_await pool.schedule();
+    for (int r = 0; r < rounds; ++r) {
+        auto lock = co_await m.scoped_lock();
+        ++counter;
+        co_await pool.schedule();
+        ++counter;
+    }
+    done.count_down();
+}
+
+client semaphore_client(thread_pool& pool, async_semaphore& s, std::atomic<long>& counter, std::latch& done) {
+    co_await pool.schedule();
+    for (int r = 0; r < rounds; ++r) {
+        co_await s.acquire();
+        co_await pool.schedule();
+        counter.fetch_add(1, std::memory_order_relaxed);
+        s.release();
+    }
+    done.count_down();
+}
+
+client producer(thread_pool& pool, channel<long>& ch, std::latch& done) {
+    co_await pool.schedule();
+    for (int r = 0; r < rounds; ++r) {
+        co_await ch.send(r);
+    }
+    done.count_down();
+}
+
+client consumer(thread_pool& pool, channel<long>& ch, long items, long& sum, std::latch& done) {
+    co_await pool.schedule();
+    for (long i = 0; i < items; ++i) {
+        sum += co_await ch.receive();
+    }
+    done.count_down();
+}
+
+template <typename Spawn>
+double timed(std::size_t clients, Spawn spawn) {
+    std::latch done{static_cast<std::ptrdiff_t>(clients)};
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t c = 0; c < clients; ++c) {
+        spawn(done);
+    }
+    done.wait();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Body>
+double timed_threads(std::size_t clients, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(clients);
+        for (std::size_t c = 0; c < clients; ++c) {
+            threads.emplace_back(body, c);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* name, std::size_t clients, double seconds, bool ok) {
+    std::cout << "  " << std::left << std::setw(28) << name << std::right << std::setw(8) << clients << " clients"
+              << std::fixed << std::setprecision(2) << std::setw(9)
+              << static_cast<double>(clients * rounds) / seconds / 1e6 << " M ops/s" << std::setw(9)
+              << seconds * 1e3 << " ms" << (ok ? "" : "  WRONG RESULT") << std::endl;
+}
+
+void run_coroutines(std::size_t n, unsigned workers) {
+    thread_pool pool(workers);
+    {
+        async_mutex m(pool);
+        long counter = 0;
+        double s = timed(n, [&](std::latch& done) { mutex_client(pool, m, counter, done); });
+        report("async_mutex", n, s, counter == static_cast<long>(2 * n * rounds));
+    }
+    {
+        async_semaphore sem(pool, permits);
+        std::atomic<long> counter{0};
+        double s = timed(n, [&](std::latch& done) { semaphore_client(pool, sem, counter, done); });
+        report("async_semaphore", n, s, counter.load() == static_cast<long>(n * rounds));
+    }
+    {
+        channel<long> ch(pool, capacity);
+        std::vector<long> sums(workers);
+        std::latch consumers_done{workers};
+        const long items = static_cast<long>(n * rounds);
+        for (unsigned c = 0; c < workers; ++c) {
+            long share = items / workers + (c < items % workers ? 1 : 0);
+            consumer(pool, ch, share, sums[c], consumers_done);
+        }
+        double s = timed(n, [&](std::latch& done) { producer(pool, ch, done); });
+        consumers_done.wait();
+        long sum = 0;
+        for (long v : sums) {
+            sum += v;
+        }
+        report("channel", n, s, sum == static_cast<long>(n) * (rounds * (rounds - 1) / 2));
+    }
+}
+
+void run_threads(std::size_t n, unsigned workers) {
+    {
+        std::mutex m;
+        long counter = 0;
+        double s = timed_threads(n, [&](std::size_t) {
+            for (int r = 0; r < rounds; ++r) {
+                std::lock_guard lock{m};
+                ++counter;
+                std::this_thread::yield();
+                ++counter;
+            }
+        });
+        report("std::mutex", n, s, counter == static_cast<long>(2 * n * rounds));
+    }
+    {
+        std::counting_semaphore<permits> sem(permits);
+        std::atomic<long> counter{0};
+        double s = timed_threads(n, [&](std::size_t) {
+            for (int r = 0; r < rounds; ++r) {
+                sem.acquire();
+                std::this_thread::yield();
+                counter.fetch_add(1, std::memory_order_relaxed);
+                sem.release();
+            }
+        });
+        report("std::counting_semaphore", n, s, counter.load() == static_cast<long>(n * rounds));
+    }
+    {
+        blocking_channel<long> ch(capacity);
+        std::atomic<long> sum{0};
+        const long items = static_cast<long>(n * rounds);
+        std::vector<std::jthread> consumers;
+        for (unsigned c = 0; c < workers; ++c) {
+            long share = items / workers + (c < items % workers ? 1 : 0);
+            consumers.emplace_back([&, share] {
+                long mine = 0;
+                for (long i = 0; i < share; ++i) {
+                    mine += ch.receive();
+                }
+                sum += mine;
+            });
+        }
+        double s = timed_threads(n, [&](std::size_t) {
+            for (int r = 0; r < rounds; ++r) {
+                ch.send(r);
+            }
+        });
+        consumers.clear();
+        report("mutex + condition_variable", n, s, sum.load() == static_cast<long>(n) * (rounds * (rounds - 1) / 2));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t coroutines = argc > 1 ? std::stoull(argv[1]) : 100'000;
+    std::size_t threads = argc > 2 ? std::stoull(argv[2]) : 1'000;
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << rounds << " rounds per client, semaphore permits " << permits << ", channel capacity " << capacity
+              << std::endl;
+    std::cout << "coroutines on " << workers << " pool threads:" << std::endl;
+    run_coroutines(coroutines, workers);
+    std::cout << "one std::thread per client:" << std::endl;
+    run_threads(threads, workers);
+
+    pthread_attr_t attr;
+    std::size_t stack = 0;
+    pthread_attr_init(&attr);
+    pthread_attr_getstacksize(&attr, &stack);
+    pthread_attr_destroy(&attr);
+    std::cout << "memory per waiting client: coroutine frame " << client::frame_bytes.load() << " bytes, thread stack "
+              << (stack >> 10) << " KiB reserved" << std::endl;
+    return 0;
+}
@@ -0,0 +1,277 @@
+// A task scheduler with cooperative cancellation, built from the std::jthread
+// and stop_token pieces of jthread.md. Every task is submitted with a stop
+// token taken from a cancel_scope, and scopes form a tree (scheduler ->
+// request -> subtask): a child's stop_source is linked to its parent's token
+// by a std::stop_callback, so cancelling a scope stops exactly its subtree,
+// one callback per descendant. Workers drop a queued task whose token is
+// already stopped without running it, and running tasks check their token
+// between chunks of work.
+// The benchmark offers twice as many requests as the workers can serve, each
+// with a deadline; a request that misses it is cancelled, shedding its
+// remaining subtasks, or is left to run to completion.
+// Build: g++ -std=c++20 -O2 -pthread cancellation_scheduler.cpp
+// Usage: ./a.out [requests] [workers]   (default 4'000, hardware threads)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A node of the cancellation tree. A root scope is cancelled only by
+// cancel(); a child scope also stops when its parent's token does. The
+// link is a stop_callback, so it unregisters itself when the child goes away.
+class cancel_scope {
+public:
+    cancel_scope() = default;
+    explicit cancel_scope(std::stop_token parent) : link_(std::in_place, std::move(parent), forward{source_}) {}
+
+    cancel_scope(const cancel_scope&) = delete;
+    cancel_scope& operator=(const cancel_scope&) = delete;
+
+    std::stop_token token() const { return source_.get_token(); }
+    void cancel() { source_.request_stop(); }
+    bool cancelled() const { return source_.stop_requested(); }
+
+private:
+    struct forward {
+        std::stop_source target;
+        void operator()() const { target.request_stop(); }
+    };
+
+    std::stop_source source_;
+    std::optional<std::stop_callback<forward>> link_;
+};
+
+class scheduler {
+public:
+    using task = std::function<void(std::stop_token)>;
+
+    struct counters {
+        std::size_t run = 0;
+        std::size_t dropped = 0;
+    };
+
+    explicit scheduler(unsigned workers) : stats_(workers) {
+        for (unsigned w = 0; w < workers; ++w) {
+            workers_.emplace_back([this, w](std::stop_token st) { work(st, stats_[w]); });
+        }
+    }
+
+    ~scheduler() {
+        for (auto& w : workers_) {
+            w.request_stop();
+        }
+        cv_.notify_all();
+    }
+
+    // The root of every scope created for work on this scheduler.
+    std::stop_token token() const { return root_.token(); }
+
+    void submit(std::stop_token token, task fn) {
+        {
+            std::lock_guard lock{mx_};
+            queue_.push_back({std::move(token), std::move(fn)});
+        }
+        cv_.notify_one();
+    }
+
+    counters totals() const {
+        std::lock_guard lock{mx_};
+        counters sum;
+        for (const counters& c : stats_) {
+            sum.run += c.run;
+            sum.dropped += c.dropped;
+        }
+        return sum;
+    }
+
+    void wait_idle() {
+        std::unique_lock lock{mx_};
+        idle_.wait(lock, [this] { return queue_.empty() && busy_ == 0; });
+    }
+
+private:
+    struct entry {
+        std::stop_token token;
+        task fn;
+    };
+
+    void work(std::stop_token st, counters& stats) {
+        std::unique_lock lock{mx_};
+        while (cv_.wait(lock, st, [this] { return !queue_.empty(); })) {
+            entry e = std::move(queue_.front());
+            queue_.pop_front();
+            if (e.token.stop_requested()) {
+                ++stats.dropped;
+                notify_if_idle();
+                continue;
+            }
+            ++busy_;
+            lock.unlock();
+            e.fn(e.token);
+            lock.lock();
+            --busy_;
+            ++stats.run;
+            notify_if_idle();
+        }
+    }
+
+    void notify_if_idle() {
+        if (queue_.empty() && busy_ == 0) {
+            idle_.notify_all();
+        }
+    }
+
+    cancel_scope root_;
+    mutable std::mutex mx_;
+    std::condition_variable_any cv_;
+    std::condition_variable_any idle_;
+    std::deque<entry> queue_;
+    unsigned busy_ = 0;
+    std::vector<counters> stats_;
+    std::vector<std::jthread> workers_;
+};
+
+// One request fans out into subtasks, each of which is a number of fixed-size
+// chunks of CPU work with a stop check in between.
+constexpr int subtasks_per_request = 4;
+constexpr int chunks_per_subtask = 5;
+constexpr auto chunk = std::chrono::microseconds(20);
+constexpr auto deadline = std::chrono::milliseconds(5);
+
+void burn(std::chrono::nanoseconds d) {
+    auto end = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+struct request {
+    request(std::stop_token parent, std::chrono::steady_clock::time_point deadline_at)
+        : scope(std::move(parent)), due(deadline_at) {}
+    cancel_scope scope;
+    std::vector<std::unique_ptr<cancel_scope>> subtask_scopes;
+    std::chrono::steady_clock::time_point due;
+    std::atomic<int> remaining{subtasks_per_request};
+    std::atomic<bool> on_time{false};
+    std::atomic<int> chunks{0};
+};
+
+struct outcome {
+    std::size_t on_time = 0, late = 0, cancelled = 0;
+    std::size_t useful_chunks = 0, wasted_chunks = 0;
+    scheduler::counters tasks;
+    double seconds = 0;
+};
+
+outcome run(std::size_t requests, unsigned workers, bool shed) {
+    scheduler pool(workers);
+    std::vector<std::shared_ptr<request>> all;
+    std::deque<std::shared_ptr<request>> pending;  // in deadline order, since all deadlines are equally far away
+
+    // Twice the rate the workers can sustain.
+    const auto work_per_request = chunk * subtasks_per_request * chunks_per_subtask;
+    const auto interval = work_per_request / (2 * workers);
+
+    auto expire = [&](std::chrono::steady_clock::time_point now) {
+        while (!pending.empty() && pending.front()->due <= now) {
+            if (shed && pending.front()->remaining.load() != 0) {
+                pending.front()->scope.cancel();
+            }
+            pending.pop_front();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < requests; ++i) {
+        auto arrival = start + i * interval;
+        std::this_thread::sleep_until(arrival);
+        expire(std::chrono::steady_clock::now());
+
+        auto r = std::make_shared<request>(pool.token(), arrival + deadline);
+        for (int s = 0; s < subtasks_per_request; ++s) {
+            r->subtask_scopes.push_back(std::make_unique<cancel_scope>(r->scope.token()));
+        }
+        for (int s = 0; s < subtasks_per_request; ++s) {
+            pool.submit(r->subtask_scopes[s]->token(), [r](std::stop_token st) {
+                for (int c = 0; c < chunks_per_subtask; ++c) {
+                    if (st.stop_requested()) {
+                        return;
+                    }
+                    burn(chunk);
+                    r->chunks.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (r->remaining.fetch_sub(1) == 1) {
+                    r->on_time = std::chrono::steady_clock::now() <= r->due;
+                }
+            });
+        }
+        pending.push_back(r);
+        all.push_back(std::move(r));
+    }
+    // The backlog left when arrivals stop still has deadlines to enforce.
+    while (shed && !pending.empty()) {
+        std::this_thread::sleep_until(pending.front()->due);
+        expire(pending.front()->due);
+    }
+    pool.wait_idle();
+
+    outcome o;
+    o.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    o.tasks = pool.totals();
+    for (const auto& r : all) {
+        auto chunks = static_cast<std::size_t>(r->chunks.load());
+        if (r->remaining.load() != 0) {
+            ++o.cancelled;
+            o.wasted_chunks += chunks;
+        } else if (r->on_time) {
+            ++o.on_time;
+            o.useful_chunks += chunks;
+        } else {
+            ++o.late;
+            o.wasted_chunks += chunks;
+        }
+    }
+    return o;
+}
+
+void print(const char* name, const outcome& o) {
+    auto ms = [](std::size_t chunks) {
+        return std::chrono::duration<double, std::milli>(chunk * static_cast<long>(chunks)).count();
+    };
+    std::cout << name << std::endl
+              << "  requests: " << o.on_time << " on time, " << o.late << " late, " << o.cancelled << " cancelled"
+              << std::endl
+              << "  subtasks: " << o.tasks.run << " run, " << o.tasks.dropped << " dropped from the queue" << std::endl
+              << std::fixed << std::setprecision(0) << "  CPU work: " << ms(o.useful_chunks + o.wasted_chunks)
+              << " ms, of which " << ms(o.wasted_chunks) << " ms for requests that missed their deadline; "
+              << std::setprecision(2) << o.seconds << " s wall" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t requests = argc > 1 ? std::stoull(argv[1]) : 4'000;
+    unsigned workers =
+        argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+    if (workers == 0) {
+        std::cerr << "workers must be at least 1" << std::endl;
+        return 1;
+    }
+
+    std::cout << requests << " requests of " << subtasks_per_request << " x " << chunks_per_subtask << " x "
+              << chunk.count() << " us, deadline " << deadline.count() << " ms, " << workers
+              << " workers, offered load 200%" << std::endl;
+    print("run to completion", run(requests, workers, false));
+    print("cancel at deadline", run(requests, workers, true));
+    return 0;
+}
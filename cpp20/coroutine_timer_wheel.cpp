@@ -0,0 +1,438 @@
+// Coroutine timers on an event loop instead of one sleeping thread per timer
+// (the Timer awaitable in coroutines.md). A pending timer is a 24-byte node
+// inside the awaiting coroutine's frame, linked into a hierarchical timer
+// wheel; the loop resumes expired coroutines from a ready queue and sleeps in
+// epoll_wait on a timerfd armed for the next occupied wheel slot. The sharded
+// variant runs one such loop per thread.
+// Build: g++ -std=c++20 -O2 coroutine_timer_wheel.cpp   (Linux)
+// Usage: ./a.out [timers] [shards]   (default 1'000'000, hardware threads)
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+struct timer_node {
+    timer_node* next;
+    std::coroutine_handle<> handle;
+    std::uint64_t expiry;  // in ticks
+};
+
+// Four levels of 64 slots: level l holds timers due in the current
+// 64^(l+1)-tick block, so 2^24 ticks (4.6 hours at 1 ms) before the overflow
+// list. When level 0 wraps, the next slot of level 1 is redistributed into
+// level 0, and so on up. Occupancy bitmaps let advance() skip empty slots.
+class timer_wheel {
+public:
+    static constexpr unsigned bits = 6;
+    static constexpr unsigned levels = 4;
+    static constexpr std::uint64_t slot_mask = (1u << bits) - 1;
+
+    std::uint64_t now() const { return now_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void insert(timer_node* node) {
+        ++size_;
+        place(node);
+    }
+
+    // Earliest tick at which advance() can have work: the next occupied
+    // level-0 slot in this rotation, or the next level-0 wrap.
+    std::uint64_t next_tick() const {
+        std::uint64_t slot = now_ & slot_mask;
+        std::uint64_t later = slot == slot_mask ? 0 : occupied_[0] & (~std::uint64_t{0} << (slot + 1));
+        return later ? (now_ & ~slot_mask) + static_cast<std::uint64_t>(std::countr_zero(later)) : (now_ | slot_mask) + 1;
+    }
+
+    // Moves the wheel to `target`, appending every expired coroutine to ready.
+    void advance(std::uint64_t target, std::vector<std::coroutine_handle<>>& ready) {
+        while (now_ < target) {
+            std::uint64_t next = next_tick();
+            if (next > target) {
+                now_ = target;
+                return;
+            }
+            now_ = next;
+            if ((now_ & slot_mask) == 0) {
+                cascade();
+            }
+            std::uint64_t slot = now_ & slot_mask;
+            for (timer_node* node = std::exchange(slots_[0][slot], nullptr); node;) {
+                timer_node* next_node = node->next;
+                ready.push_back(node->handle);
+                --size_;
+                node = next_node;
+            }
+            occupied_[0] &= ~(std::uint64_t{1} << slot);
+        }
+    }
+
+private:
+    void place(timer_node* node) {
+        for (unsigned level = 0; level < levels; ++level) {
+            unsigned shift = bits * (level + 1);
+            if ((node->expiry >> shift) == (now_ >> shift)) {
+                std::uint64_t slot = (node->expiry >> (bits * level)) & slot_mask;
+                node->next = slots_[level][slot];
+                slots_[level][slot] = node;
+                occupied_[level] |= std::uint64_t{1} << slot;
+                return;
+            }
+        }
+        node->next = overflow_;
+        overflow_ = node;
+    }
+
+    void cascade() {
+        for (unsigned level = 1; level <= levels; ++level) {
+            timer_node* node;
+            if (level == levels) {
+                node = std::exchange(overflow_, nullptr);
+            } else {
+                std::uint64_t slot = (now_ >> (bits * level)) & slot_mask;
+                node = std::exchange(slots_[level][slot], nullptr);
+                occupied_[level] &= ~(std::uint64_t{1} << slot);
+            }
+            while (node) {
+                timer_node* next = node->next;
+                place(node);
+                node = next;
+            }
+            if (level < levels && ((now_ >> (bits * level)) & slot_mask) != 0) {
+                return;
+            }
+        }
+    }
+
+    timer_node* slots_[levels][1u << bits] = {};
+    std::uint64_t occupied_[levels] = {};
+    timer_node* overflow_ = nullptr;
+    std::uint64_t now_ = 0;
+    std::size_t size_ = 0;
+};
+
+class event_loop {
+public:
+    using tick = std::chrono::milliseconds;
+
+    event_loop() : epoll_(epoll_create1(EPOLL_CLOEXEC)), timer_(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)),
+                   wake_(eventfd(0, EFD_CLOEXEC)), start_(monotonic_ns()) {
+        if (epoll_ < 0 || timer_ < 0 || wake_ < 0) {
+            throw std::runtime_error("event_loop: cannot create epoll, timerfd or eventfd");
+        }
+        for (int fd : {timer_, wake_}) {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+    ~event_loop() {
+        close(epoll_);
+        close(timer_);
+        close(wake_);
+    }
+    event_loop(const event_loop&) = delete;
+    event_loop& operator=(const event_loop&) = delete;
+
+    // From the loop's own thread.
+    void post(std::coroutine_handle<> h) { ready_.push_back(h); }
+
+    // From any thread.
+    void post_remote(std::coroutine_handle<> h) {
+        {
+            std::lock_guard lock{inbox_mx_};
+            inbox_.push_back(h);
+        }
+        wake();
+    }
+
+    // Lets run() return once all work is done; until then it waits for posts.
+    void close_when_idle() {
+        closing_.store(true);
+        wake();
+    }
+
+    struct sleep_awaiter {
+        event_loop& loop;
+        timer_node node;
+
+        bool await_ready() const noexcept { return node.expiry <= loop.wheel_.now(); }
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            node.handle = h;
+            loop.wheel_.insert(&node);
+        }
+        void await_resume() const noexcept {}
+    };
+
+    // Rounds up to whole ticks, plus one for the part of the current tick
+    // that has already passed, so a timer never fires early.
+    sleep_awaiter sleep_for(std::chrono::nanoseconds d) {
+        std::uint64_t ticks = static_cast<std::uint64_t>((d + tick(1) - std::chrono::nanoseconds(1)) / tick(1));
+        return {*this, {nullptr, {}, current_tick() + ticks + 1}};
+    }
+
+    void run() {
+        std::vector<std::coroutine_handle<>> running;
+        for (;;) {
+            {
+                std::lock_guard lock{inbox_mx_};
+                ready_.insert(ready_.end(), inbox_.begin(), inbox_.end());
+                inbox_.clear();
+            }
+            wheel_.advance(current_tick(), ready_);
+            if (!ready_.empty()) {
+                running.swap(ready_);
+                for (std::coroutine_handle<> h : running) {
+                    h.resume();
+                }
+                running.clear();
+                continue;
+            }
+            if (wheel_.empty() && closing_.load()) {
+                std::lock_guard lock{inbox_mx_};
+                if (inbox_.empty()) {
+                    return;
+                }
+                continue;
+            }
+            wait();
+        }
+    }
+
+private:
+    static std::int64_t monotonic_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+    }
+
+    std::uint64_t current_tick() const {
+        return static_cast<std::uint64_t>((monotonic_ns() - start_) / std::chrono::nanoseconds(tick(1)).count());
+    }
+
+    void wake() {
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto n = write(wake_, &one, sizeof one);
+    }
+
+    // Sleeps until the next wheel slot is due or another thread posts.
+    void wait() {
+        itimerspec spec{};
+        if (!wheel_.empty()) {
+            std::int64_t due = start_ + static_cast<std::int64_t>(wheel_.next_tick()) * std::chrono::nanoseconds(tick(1)).count();
+            spec.it_value.tv_sec = due / 1'000'000'000;
+            spec.it_value.tv_nsec = due % 1'000'000'000;
+        }
+        timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+        epoll_event events[2];
+        int n = epoll_wait(epoll_, events, 2, -1);
+        for (int i = 0; i < n; ++i) {
+            std::uint64_t count;
+            [[maybe_unused]] auto r = read(events[i].data.fd, &count, sizeof count);
+        }
+    }
+
+    int epoll_;
+    int timer_;
+    int wake_;
+    std::int64_t start_;
+    timer_wheel wheel_;
+    std::vector<std::coroutine_handle<>> ready_;
+    std::mutex inbox_mx_;
+    std::vector<std::coroutine_handle<>> inbox_;
+    std::atomic<bool> closing_{false};
+};
+
+// One event loop per thread; work is spread round-robin and then stays on
+// its shard, so timers never cross threads.
+class sharded_event_loop {
+public:
+    explicit sharded_event_loop(unsigned shards) : loops_(shards) {
+        for (auto& loop : loops_) {
+            loop = std::make_unique<event_loop>();
+        }
+    }
+
+    event_loop& shard(std::size_t i) { return *loops_[i % loops_.size()]; }
+    std::size_t size() const { return loops_.size(); }
+
+    void run() {
+        std::vector<std::jthread> threads;
+        for (auto& loop : loops_) {
+            threads.emplace_back([&loop] { loop->run(); });
+        }
+        for (auto& loop : loops_) {
+            loop->close_when_idle();
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<event_loop>> loops_;
+};
+
+// Fire-and-forget coroutine: created suspended, handed to a loop, destroys
+// itself when it finishes.
+struct task {
+    struct promise_type {
+        inline static std::size_t frame_bytes = 0;
+
+        static void* operator new(std::size_t size) {
+            frame_bytes += size;
+            return ::operator new(size);
+        }
+        static void operator delete(void* p) { ::operator delete(p); }
+
+        task get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<> handle;
+};
+
+struct lateness_stats {
+    std::int64_t total_ns = 0;
+    std::int64_t worst_ns = 0;
+    std::size_t completed = 0;
+
+    void add(std::chrono::steady_clock::time_point deadline) {
+        std::int64_t late = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - deadline).count();
+        total_ns += late;
+        worst_ns = std::max(worst_ns, late);
+        ++completed;
+    }
+};
+
+task sleeper(event_loop& loop, std::chrono::milliseconds delay, lateness_stats& stats) {
+    auto deadline = std::chrono::steady_clock::now() + delay;
+    co_await loop.sleep_for(delay);
+    stats.add(deadline);
+}
+
+// The awaitable from coroutines.md, for comparison.
+struct Timer {
+    std::chrono::milliseconds duration;
+    Timer(std::chrono::milliseconds d) : duration(d) {}
+
+    bool await_ready() const noexcept { return duration.count() == 0; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+        std::thread([handle, duration = this->duration] {
+            std::this_thread::sleep_for(duration);
+            handle.resume();
+        }).detach();
+    }
+    void await_resume() const noexcept {}
+};
+
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached thread_sleeper(std::chrono::milliseconds delay, std::mutex& mx, lateness_stats& stats, std::atomic<std::size_t>& done) {
+    auto deadline = std::chrono::steady_clock::now() + delay;
+    co_await Timer{delay};
+    {
+        std::lock_guard lock{mx};
+        stats.add(deadline);
+    }
+    done.fetch_add(1);
+    done.notify_one();
+}
+
+void report(const char* name, std::size_t timers, double seconds, const lateness_stats& stats) {
+    std::cout << name << timers << " timers in " << seconds << " s, lateness mean "
+              << stats.total_ns / 1e6 / static_cast<double>(std::max<std::size_t>(1, stats.completed)) << " ms, worst "
+              << stats.worst_ns / 1e6 << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t timers = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    unsigned shards = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> delay_ms(1, 1000);
+    std::vector<std::chrono::milliseconds> delays(timers);
+    for (auto& d : delays) {
+        d = std::chrono::milliseconds(delay_ms(gen));
+    }
+
+    {
+        event_loop loop;
+        lateness_stats stats;
+        auto start = std::chrono::steady_clock::now();
+        for (auto d : delays) {
+            loop.post(sleeper(loop, d, stats).handle);
+        }
+        loop.close_when_idle();
+        loop.run();
+        report("event loop:        ", timers, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), stats);
+        std::cout << "  " << task::promise_type::frame_bytes / timers << " bytes per coroutine frame, of which "
+                  << sizeof(timer_node) << " are the timer node" << std::endl;
+    }
+
+    {
+        sharded_event_loop loops(shards);
+        std::vector<lateness_stats> stats(shards);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < timers; ++i) {
+            event_loop& loop = loops.shard(i);
+            loop.post_remote(sleeper(loop, delays[i], stats[i % shards]).handle);
+        }
+        loops.run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        lateness_stats total;
+        for (const auto& s : stats) {
+            total.total_ns += s.total_ns;
+            total.worst_ns = std::max(total.worst_ns, s.worst_ns);
+            total.completed += s.completed;
+        }
+        std::string name = "sharded x" + std::to_string(shards) + ":";
+        name.resize(19, ' ');
+        report(name.c_str(), timers, seconds, total);
+    }
+
+    {
+        // One OS thread per pending timer; kept small enough not to hit the
+        // process thread limit. Static, because the last detached thread may
+        // still be leaving the coroutine when main moves on.
+        std::size_t thread_timers = std::min<std::size_t>(timers, 2'000);
+        static std::mutex mx;
+        static lateness_stats stats;
+        static std::atomic<std::size_t> done{0};
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < thread_timers; ++i) {
+            thread_sleeper(delays[i], mx, stats, done);
+        }
+        for (std::size_t seen = done.load(); seen < thread_timers; seen = done.load()) {
+            done.wait(seen);
+        }
+        report("thread per timer:  ", thread_timers, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), stats);
+    }
+    return 0;
+}
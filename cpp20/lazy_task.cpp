@@ -0,0 +1,570 @@
+// A lazy Task<T>, as an alternative to the eager Task of coroutines.md, which
+// starts running when it is called and destroys its handle in the destructor
+// even after the frame has freed itself (see also the eager coroutines of
+// coroutinesInDetail.md). This Task does nothing until it is awaited. When it
+// finishes, final_suspend hands control straight to the awaiting coroutine by
+// symmetric transfer (await_suspend returns the next handle), so a chain of
+// a million nested awaits runs in constant stack space. On top of it:
+//  - sync_wait(task): runs a task from ordinary code and blocks until it ends;
+//  - when_all(tasks...): runs tasks concurrently and returns all results;
+//  - when_any(stop_source, tasks): returns the result of the first task to
+//    finish and requests a stop so that the others end early.
+// Both combinators are structured: they complete only after every child has
+// completed, so no child outlives the frame whose locals it may reference.
+// The benchmark measures the cost of one await hop and the stack used by a
+// chain of awaits, against a chain of callback-based futures, and then runs
+// when_all and when_any on a thread pool.
+// Build: g++ -std=c++20 -O2 -pthread lazy_task.cpp
+// Usage: ./a.out [fan-out tasks]   (default 10'000)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace detail {
+
+// The result part of a promise: a value (or nothing, for void) or the
+// exception that escaped the coroutine body.
+template <typename T>
+struct task_result {
+    std::variant<std::monostate, T, std::exception_ptr> result;
+
+    void return_value(T value) { result.template emplace<1>(std::move(value)); }
+    void unhandled_exception() noexcept { result.template emplace<2>(std::current_exception()); }
+    T get() {
+        if (result.index() == 2) {
+            std::rethrow_exception(std::get<2>(result));
+        }
+        return std::move(std::get<1>(result));
+    }
+};
+
+template <>
+struct task_result<void> {
+    std::exception_ptr error;
+
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+    void get() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// What the combinators store for a Task<void>.
+template <typename T>
+using value_or_monostate = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+}  // namespace detail
+
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : detail::task_result<T> {
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                return h.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        final_awaiter final_suspend() noexcept { return {}; }
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        std::swap(handle_, other.handle_);
+        return *this;
+    }
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    // Starts the task and suspends the awaiting coroutine until it is done.
+    // Only an rvalue can be awaited, since the result is moved out.
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            std::coroutine_handle<promise_type> task;
+
+            bool await_ready() const noexcept { return task.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                task.promise().continuation = awaiting;
+                return task;
+            }
+            T await_resume() { return task.promise().get(); }
+        };
+        return awaiter{handle_};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+// A coroutine that awaits one Task, keeps its result and, when done, calls
+// Notify instead of resuming an awaiting coroutine. Notify returns the
+// coroutine to transfer to, which may be std::noop_coroutine().
+template <typename T, typename Notify>
+class relay {
+public:
+    struct promise_type : task_result<T> {
+        Notify notify;
+
+        relay get_return_object() { return relay{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                return h.promise().notify();
+            }
+            void await_resume() noexcept {}
+        };
+        final_awaiter final_suspend() noexcept { return {}; }
+    };
+
+    relay(relay&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    ~relay() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    void start(Notify notify) {
+        handle_.promise().notify = std::move(notify);
+        handle_.resume();
+    }
+
+    value_or_monostate<T> result() {
+        if constexpr (std::is_void_v<T>) {
+            handle_.promise().get();
+            return {};
+        } else {
+            return handle_.promise().get();
+        }
+    }
+
+private:
+    explicit relay(std::coroutine_handle<promise_type> h) : handle_(h) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename Notify, typename T>
+relay<T, Notify> make_relay(Task<T> task) {
+    if constexpr (std::is_void_v<T>) {
+        co_await std::move(task);
+    } else {
+        co_return co_await std::move(task);
+    }
+}
+
+struct release_semaphore {
+    std::binary_semaphore* done;
+    // The frame may be destroyed as soon as the semaphore is released.
+    std::coroutine_handle<> operator()() const noexcept {
+        done->release();
+        return std::noop_coroutine();
+    }
+};
+
+// Counts running children plus one for the parent, which drops its own count
+// after starting them all; whoever brings the count to zero resumes the parent.
+struct countdown {
+    explicit countdown(std::size_t children) : count(children + 1) {}
+
+    std::coroutine_handle<> arrive() noexcept {
+        return count.fetch_sub(1, std::memory_order_acq_rel) == 1 ? awaiting : std::noop_coroutine();
+    }
+
+    template <typename StartAll>
+    auto start_and_wait(StartAll start_all) {
+        struct awaiter {
+            countdown& c;
+            StartAll start_all;
+
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                c.awaiting = h;
+                start_all();
+                return c.count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this, std::move(start_all)};
+    }
+
+    std::atomic<std::size_t> count;
+    std::coroutine_handle<> awaiting;
+};
+
+struct arrive_at {
+    countdown* c;
+    std::coroutine_handle<> operator()() const noexcept { return c->arrive(); }
+};
+
+struct when_any_state {
+    static constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+    when_any_state(std::size_t children, std::stop_source s) : done(children), stop(std::move(s)) {}
+
+    countdown done;
+    std::atomic<std::size_t> winner{none};
+    std::stop_source stop;
+};
+
+struct arrive_first {
+    when_any_state* state;
+    std::size_t index;
+    std::coroutine_handle<> operator()() const noexcept {
+        std::size_t expected = when_any_state::none;
+        if (state->winner.compare_exchange_strong(expected, index)) {
+            state->stop.request_stop();
+        }
+        return state->done.arrive();
+    }
+};
+
+}  // namespace detail
+
+// Runs the task on the calling thread until its first suspension, then
+// blocks until whichever thread finishes it has done so.
+template <typename T>
+T sync_wait(Task<T> task) {
+    std::binary_semaphore done{0};
+    auto r = detail::make_relay<detail::release_semaphore>(std::move(task));
+    r.start({&done});
+    done.acquire();
+    if constexpr (std::is_void_v<T>) {
+        r.result();
+    } else {
+        return r.result();
+    }
+}
+
+// Rethrows the exception of the first task, in argument order, that failed.
+template <typename... Ts>
+Task<std::tuple<detail::value_or_monostate<Ts>...>> when_all(Task<Ts>... tasks) {
+    detail::countdown done{sizeof...(Ts)};
+    auto relays = std::make_tuple(detail::make_relay<detail::arrive_at>(std::move(tasks))...);
+    co_await done.start_and_wait([&] { std::apply([&](auto&... r) { (r.start({&done}), ...); }, relays); });
+    co_return std::apply([](auto&... r) { return std::tuple{r.result()...}; }, relays);
+}
+
+template <typename T>
+Task<std::vector<detail::value_or_monostate<T>>> when_all(std::vector<Task<T>> tasks) {
+    detail::countdown done{tasks.size()};
+    std::vector<detail::relay<T, detail::arrive_at>> relays;
+    relays.reserve(tasks.size());
+    for (Task<T>& t : tasks) {
+        relays.push_back(detail::make_relay<detail::arrive_at>(std::move(t)));
+    }
+    co_await done.start_and_wait([&] {
+        for (auto& r : relays) {
+            r.start({&done});
+        }
+    });
+    std::vector<detail::value_or_monostate<T>> results;
+    results.reserve(relays.size());
+    for (auto& r : relays) {
+        results.push_back(r.result());
+    }
+    co_return results;
+}
+
+template <typename T>
+struct when_any_result {
+    std::size_t index;
+    detail::value_or_monostate<T> value;
+};
+
+// The first task to finish wins and stop.request_stop() is called; tasks that
+// hold stop.get_token() can then end early. Results and exceptions of the
+// other tasks are discarded.
+template <typename T>
+Task<when_any_result<T>> when_any(std::stop_source stop, std::vector<Task<T>> tasks) {
+    if (tasks.empty()) {
+        throw std::invalid_argument("when_any of no tasks");
+    }
+    detail::when_any_state state{tasks.size(), std::move(stop)};
+    std::vector<detail::relay<T, detail::arrive_first>> relays;
+    relays.reserve(tasks.size());
+    for (Task<T>& t : tasks) {
+        relays.push_back(detail::make_relay<detail::arrive_first>(std::move(t)));
+    }
+    co_await state.done.start_and_wait([&] {
+        for (std::size_t i = 0; i < relays.size(); ++i) {
+            relays[i].start({&state, i});
+        }
+    });
+    std::size_t winner = state.winner.load();
+    co_return when_any_result<T>{winner, relays[winner].result()};
+}
+
+// Worker threads that resume coroutines; co_await pool.schedule() moves the
+// rest of a coroutine onto one of them.
+class thread_pool {
+public:
+    explicit thread_pool(unsigned threads) {
+        for (unsigned t = 0; t < threads; ++t) {
+            workers_.emplace_back([this](std::stop_token st) { work(st); });
+        }
+    }
+
+    ~thread_pool() {
+        for (auto& w : workers_) {
+            w.request_stop();
+        }
+        cv_.notify_all();
+    }
+
+    auto schedule() {
+        struct awaiter {
+            thread_pool& pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                {
+                    std::lock_guard lock{pool.mx_};
+                    pool.queue_.push_back(h);
+                }
+                pool.cv_.notify_one();
+            }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this};
+    }
+
+private:
+    void work(std::stop_token st) {
+        std::unique_lock lock{mx_};
+        while (cv_.wait(lock, st, [this] { return !queue_.empty(); })) {
+            std::coroutine_handle<> h = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            h.resume();
+            lock.lock();
+        }
+    }
+
+    std::mutex mx_;
+    std::condition_variable_any cv_;
+    std::deque<std::coroutine_handle<>> queue_;
+    std::vector<std::jthread> workers_;
+};
+
+// The continuation style a Task replaces: then() registers a callback that
+// runs inline when the value arrives, so a chain of N thens completes as N
+// nested calls.
+template <typename T>
+class callback_future {
+public:
+    callback_future() : state_(std::make_shared<state>()) {}
+
+    void set_value(T value) {
+        if (state_->next) {
+            state_->next(std::move(value));
+        } else {
+            state_->value = std::move(value);
+        }
+    }
+
+    template <typename F>
+    callback_future<std::invoke_result_t<F, T>> then(F f) {
+        callback_future<std::invoke_result_t<F, T>> out;
+        auto next = [f = std::move(f), out](T value) mutable { out.set_value(f(std::move(value))); };
+        if (state_->value) {
+            next(std::move(*state_->value));
+        } else {
+            state_->next = std::move(next);
+        }
+        return out;
+    }
+
+private:
+    struct state {
+        std::optional<T> value;
+        std::function<void(T)> next;
+    };
+    std::shared_ptr<state> state_;
+};
+
+// Lowest stack address seen by note_stack() since the last reset.
+char* stack_low = nullptr;
+
+void note_stack() {
+    stack_low = std::min(stack_low, static_cast<char*>(__builtin_frame_address(0)));
+}
+
+Task<int> chain(int depth) {
+    if (depth == 0) {
+        note_stack();
+        co_return 0;
+    }
+    int below = co_await chain(depth - 1);
+    note_stack();
+    co_return below + 1;
+}
+
+struct chain_cost {
+    double ns_per_hop;
+    std::size_t stack_bytes;
+};
+
+[[gnu::noinline]] chain_cost measure_task_chain(int depth) {
+    char* base = stack_low = static_cast<char*>(__builtin_frame_address(0));
+    auto start = std::chrono::steady_clock::now();
+    int result = sync_wait(chain(depth));
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (result != depth) {
+        throw std::logic_error("wrong chain result");
+    }
+    return {ns / depth, static_cast<std::size_t>(base - stack_low)};
+}
+
+[[gnu::noinline]] chain_cost measure_callback_chain(int depth) {
+    char* base = stack_low = static_cast<char*>(__builtin_frame_address(0));
+    auto start = std::chrono::steady_clock::now();
+    callback_future<int> first;
+    callback_future<int> last = first;
+    for (int i = 0; i < depth; ++i) {
+        last = last.then([](int below) {
+            note_stack();
+            return below + 1;
+        });
+    }
+    int result = -1;
+    last.then([&result](int value) { return result = value; });
+    first.set_value(0);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (result != depth) {
+        throw std::logic_error("wrong chain result");
+    }
+    return {ns / depth, static_cast<std::size_t>(base - stack_low)};
+}
+
+Task<long> partial_sum(thread_pool& pool, long from, long to) {
+    co_await pool.schedule();
+    long sum = 0;
+    for (long i = from; i < to; ++i) {
+        sum += i;
+    }
+    co_return sum;
+}
+
+// Work in chunks, giving the pool back between chunks, until done or stopped.
+Task<int> racer(thread_pool& pool, std::stop_token st, int chunks, std::atomic<int>& chunks_done) {
+    int done = 0;
+    while (done < chunks && !st.stop_requested()) {
+        co_await pool.schedule();
+        auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(100);
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        ++done;
+        chunks_done.fetch_add(1, std::memory_order_relaxed);
+    }
+    co_return done;
+}
+
+Task<std::string> describe(thread_pool& pool, int n) {
+    co_await pool.schedule();
+    co_return "task " + std::to_string(n);
+}
+
+Task<> fail(thread_pool& pool) {
+    co_await pool.schedule();
+    throw std::runtime_error("failed on a pool thread");
+}
+
+int main(int argc, char* argv[]) {
+    long fan_out = argc > 1 ? std::stol(argv[1]) : 10'000;
+
+    measure_task_chain(10);  // warm up the allocator
+    std::cout << "await chain       Task<T>: ns/hop  stack bytes   callback futures: ns/hop  stack bytes" << std::endl;
+    for (int depth : {10, 1'000, 10'000, 1'000'000}) {
+        chain_cost t = measure_task_chain(depth);
+        std::cout << "  depth " << std::left << std::setw(9) << depth << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(18) << t.ns_per_hop << std::setw(13) << t.stack_bytes;
+        // A million nested callbacks would not fit into a default 8 MiB stack.
+        if (depth <= 10'000) {
+            chain_cost c = measure_callback_chain(depth);
+            std::cout << std::setw(27) << c.ns_per_hop << std::setw(13) << c.stack_bytes;
+        } else {
+            std::cout << std::setw(40) << "(not run)";
+        }
+        std::cout << std::endl;
+    }
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    thread_pool pool(threads);
+
+    auto [first, second] = sync_wait(when_all(describe(pool, 1), describe(pool, 2)));
+    std::cout << "when_all: " << first << ", " << second << std::endl;
+    try {
+        sync_wait(when_all(describe(pool, 1), fail(pool)));
+    } catch (const std::exception& e) {
+        std::cout << "when_all rethrows: " << e.what() << std::endl;
+    }
+
+    std::vector<Task<long>> parts;
+    const long per_part = 100;
+    for (long i = 0; i < fan_out; ++i) {
+        parts.push_back(partial_sum(pool, i * per_part, (i + 1) * per_part));
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<long> sums = sync_wait(when_all(std::move(parts)));
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    long total = 0;
+    for (long s : sums) {
+        total += s;
+    }
+    const long n = fan_out * per_part;
+    std::cout << "when_all of " << fan_out << " tasks on " << threads << " threads: " << std::setprecision(2)
+              << us / static_cast<double>(fan_out) << " us per task, sum "
+              << (total == n * (n - 1) / 2 ? "ok" : "WRONG") << std::endl;
+
+    std::stop_source stop;
+    std::atomic<int> chunks_done{0};
+    const std::vector<int> chunks{50, 10, 40, 30};
+    std::vector<Task<int>> racers;
+    for (int c : chunks) {
+        racers.push_back(racer(pool, stop.get_token(), c, chunks_done));
+    }
+    start = std::chrono::steady_clock::now();
+    when_any_result<int> winner = sync_wait(when_any(stop, std::move(racers)));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "when_any: task " << winner.index << " won after " << winner.value << " chunks, "
+              << chunks_done.load() << " of " << chunks[0] + chunks[1] + chunks[2] + chunks[3] << " chunks run in "
+              << ms << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,488 @@
+// Lock-free multi-producer multi-consumer queues as a replacement for the
+// mutex-guarded std::queue plus std::counting_semaphore of processValues in
+// concurrency.md, where every consumer takes the mutex even when the queue is
+// empty:
+//  - bounded_queue: Vyukov's array queue, one sequence number per cell, so a
+//    push or pop is a single CAS on its own index;
+//  - segmented_queue: unbounded, each push and pop takes a ticket with one
+//    fetch_add and owns that slot of a linked list of fixed-size segments.
+// Blocking waits use std::atomic::wait/notify (a futex on Linux) after a
+// short spin, and producers only pay for a notify when somebody is asleep.
+// The benchmark measures throughput and push-to-pop latency percentiles at
+// 1-64 producers and as many consumers.
+// Build: g++ -std=c++20 -O2 -pthread lock_free_mpmc_queue.cpp
+// Usage: ./a.out [messages] [max threads per side]   (default 400'000, 64)
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+constexpr std::size_t cache_line = 64;
+constexpr int spin_limit = 64;
+
+// A sleeping place for threads waiting on some other atomic state, such as
+// a cell sequence number. Waiters register before their final check and
+// notify() only touches the futex when the count is non-zero; the fences on
+// both sides make sure either the waiter sees the new state or the notifier
+// sees the waiter.
+class wait_point {
+public:
+    template <typename TryOp>
+    void wait_until(TryOp try_op) {
+        for (int spin = 0; spin < spin_limit; ++spin) {
+            if (try_op()) {
+                return;
+            }
+        }
+        while (true) {
+            waiters_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::uint32_t seen = epoch_.load();
+            if (try_op()) {
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            epoch_.wait(seen);
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            if (try_op()) {
+                return;
+            }
+        }
+    }
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) != 0) {
+            epoch_.fetch_add(1);
+            epoch_.notify_one();
+        }
+    }
+
+private:
+    alignas(cache_line) std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::uint32_t> waiters_{0};
+};
+
+// Cell i is ready for the push with ticket t when its sequence equals t, and
+// for the pop with ticket t when it equals t + 1; the pop hands it on to the
+// push one lap later by storing t + capacity.
+template <typename T>
+class bounded_queue {
+public:
+    explicit bounded_queue(std::size_t capacity)
+        : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1), cells_(new cell[mask_ + 1]) {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(const T& value) {
+        std::size_t pos = push_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell& c = cells_[pos & mask_];
+            std::size_t seq = c.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = value;
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    not_empty_.notify();
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full: the cell still holds last lap's value
+            } else {
+                pos = push_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        std::size_t pos = pop_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell& c = cells_[pos & mask_];
+            std::size_t seq = c.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (pop_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = c.value;
+                    c.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    not_full_.notify();
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // empty
+            } else {
+                pos = pop_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(const T& value) {
+        not_full_.wait_until([&] { return try_push(value); });
+    }
+
+    T pop() {
+        T value;
+        not_empty_.wait_until([&] { return try_pop(value); });
+        return value;
+    }
+
+private:
+    struct cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    const std::size_t mask_;
+    std::unique_ptr<cell[]> cells_;
+    alignas(cache_line) std::atomic<std::size_t> push_pos_{0};
+    alignas(cache_line) std::atomic<std::size_t> pop_pos_{0};
+    wait_point not_empty_;
+    wait_point not_full_;
+};
+
+// Every thread that touches a segmented_queue claims one of these slots for
+// its lifetime, to publish which segments it may still be reading.
+constexpr unsigned max_threads = 256;
+
+class thread_slot {
+public:
+    static unsigned index() {
+        thread_local thread_slot slot;
+        return slot.index_;
+    }
+
+private:
+    thread_slot() {
+        for (unsigned i = 0; i < max_threads; ++i) {
+            if (!used_[i].exchange(true, std::memory_order_acquire)) {
+                index_ = i;
+                return;
+            }
+        }
+        throw std::runtime_error("more than " + std::to_string(max_threads) + " threads use segmented_queue");
+    }
+    ~thread_slot() { used_[index_].store(false, std::memory_order_release); }
+
+    static inline std::atomic<bool> used_[max_threads];
+    unsigned index_ = 0;
+};
+
+// Ticket t lives in slot t % segment_size of segment t / segment_size. Push
+// and pop each take a ticket with one fetch_add and then own that slot, so a
+// pop that runs ahead of its push simply sleeps on the slot's state.
+// Segments are appended by whichever thread first needs them and freed in
+// order once all their slots have been consumed. A thread announces the
+// oldest segment id it may still reach before each operation; a retired
+// segment is deleted only when every announcement is past it.
+template <typename T, std::size_t SegmentSize = 1024>
+class segmented_queue {
+public:
+    segmented_queue() {
+        segment* first = new segment(0);
+        oldest_.store(first);
+        push_hint_.store(first);
+        pop_hint_.store(first);
+        for (auto& r : reservations_) {
+            r.id.store(idle, std::memory_order_relaxed);
+        }
+    }
+
+    ~segmented_queue() {
+        for (segment* s = oldest_.load(); s != nullptr;) {
+            delete std::exchange(s, s->next.load());
+        }
+        for (segment* s : retired_) {
+            delete s;
+        }
+    }
+
+    segmented_queue(const segmented_queue&) = delete;
+    segmented_queue& operator=(const segmented_queue&) = delete;
+
+    void push(const T& value) {
+        std::atomic<std::uint64_t>& reservation = reserve();
+        std::uint64_t ticket = push_ticket_.fetch_add(1);
+        find(push_hint_, ticket)->slots[ticket % SegmentSize].publish(value);
+        reservation.store(idle, std::memory_order_release);
+    }
+
+    T pop() {
+        std::atomic<std::uint64_t>& reservation = reserve();
+        std::uint64_t ticket = pop_ticket_.fetch_add(1);
+        segment* s = find(pop_hint_, ticket);
+        T value = s->slots[ticket % SegmentSize].take();
+        if (s->consumed.fetch_add(1, std::memory_order_acq_rel) == SegmentSize - 1) {
+            retire_consumed();
+        }
+        reservation.store(idle, std::memory_order_release);
+        return value;
+    }
+
+private:
+    static constexpr std::uint64_t idle = ~std::uint64_t{0};
+
+    struct slot {
+        enum : std::uint32_t { empty, full, waiting };
+        std::atomic<std::uint32_t> state{empty};
+        T value;
+
+        void publish(const T& v) {
+            value = v;
+            if (state.exchange(full, std::memory_order_acq_rel) == waiting) {
+                state.notify_one();
+            }
+        }
+
+        T take() {
+            for (int spin = 0; spin < spin_limit; ++spin) {
+                if (state.load(std::memory_order_acquire) == full) {
+                    return value;
+                }
+            }
+            std::uint32_t expected = empty;
+            state.compare_exchange_strong(expected, waiting, std::memory_order_acquire);
+            while (state.load(std::memory_order_acquire) != full) {
+                state.wait(waiting, std::memory_order_acquire);
+            }
+            return value;
+        }
+    };
+
+    struct segment {
+        explicit segment(std::uint64_t i) : id(i) {}
+        const std::uint64_t id;
+        std::atomic<segment*> next{nullptr};
+        alignas(cache_line) std::atomic<std::size_t> consumed{0};
+        slot slots[SegmentSize];
+    };
+
+    struct alignas(cache_line) reservation {
+        std::atomic<std::uint64_t> id;
+    };
+
+    std::atomic<std::uint64_t>& reserve() {
+        std::atomic<std::uint64_t>& r = reservations_[thread_slot::index()].id;
+        std::uint64_t oldest = retired_below_.load();
+        while (true) {
+            r.store(oldest);
+            std::uint64_t now = retired_below_.load();
+            if (now == oldest) {
+                return r;
+            }
+            oldest = now;
+        }
+    }
+
+    // Walks from the hint to the segment holding ticket, appending segments as
+    // needed, and moves the hint forward. A thread with a later ticket may
+    // already have moved the hint past this one; the walk then starts from the
+    // oldest segment, which cannot be past a ticket that is still pending.
+    segment* find(std::atomic<segment*>& hint, std::uint64_t ticket) {
+        const std::uint64_t id = ticket / SegmentSize;
+        segment* start = hint.load(std::memory_order_acquire);
+        if (start->id > id) {
+            start = oldest_.load();
+        }
+        segment* s = start;
+        while (s->id < id) {
+            segment* next = s->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                auto* fresh = new segment(s->id + 1);
+                if (s->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel)) {
+                    next = fresh;
+                } else {
+                    delete fresh;
+                }
+            }
+            s = next;
+        }
+        if (s != start) {
+            advance(hint, s);
+        }
+        return s;
+    }
+
+    static void advance(std::atomic<segment*>& hint, segment* to) {
+        segment* current = hint.load(std::memory_order_acquire);
+        while (current->id < to->id && !hint.compare_exchange_weak(current, to, std::memory_order_acq_rel)) {
+        }
+    }
+
+    // Unlinks fully consumed segments from the front of the list. A segment
+    // is only unlinked once it has a successor, so the hints always have
+    // somewhere to point.
+    void retire_consumed() {
+        while (true) {
+            segment* front = oldest_.load();
+            segment* next = front->next.load();
+            if (front->consumed.load() != SegmentSize || next == nullptr ||
+                !oldest_.compare_exchange_strong(front, next)) {
+                return;
+            }
+            advance(push_hint_, next);
+            advance(pop_hint_, next);
+            retired_below_.store(next->id);
+
+            std::vector<segment*> reclaim;
+            {
+                std::lock_guard lock{retired_mx_};
+                retired_.push_back(front);
+                std::uint64_t in_use = idle;
+                for (const auto& r : reservations_) {
+                    in_use = std::min(in_use, r.id.load());
+                }
+                auto still_visible = std::partition(retired_.begin(), retired_.end(),
+                                                    [&](const segment* s) { return s->id >= in_use; });
+                reclaim.assign(still_visible, retired_.end());
+                retired_.erase(still_visible, retired_.end());
+            }
+            for (segment* s : reclaim) {
+                delete s;
+            }
+        }
+    }
+
+    alignas(cache_line) std::atomic<std::uint64_t> push_ticket_{0};
+    alignas(cache_line) std::atomic<std::uint64_t> pop_ticket_{0};
+    alignas(cache_line) std::atomic<segment*> push_hint_;
+    alignas(cache_line) std::atomic<segment*> pop_hint_;
+    alignas(cache_line) std::atomic<segment*> oldest_;
+    std::atomic<std::uint64_t> retired_below_{0};
+    reservation reservations_[max_threads];
+    std::mutex retired_mx_;
+    std::vector<segment*> retired_;
+};
+
+// The design of processValues in concurrency.md: a std::queue behind a mutex,
+// and a counting semaphore that counts the queued values.
+template <typename T>
+class mutex_semaphore_queue {
+public:
+    void push(const T& value) {
+        {
+            std::lock_guard lock{mx_};
+            values_.push(value);
+        }
+        available_.release();
+    }
+
+    T pop() {
+        available_.acquire();
+        std::lock_guard lock{mx_};
+        T value = values_.front();
+        values_.pop();
+        return value;
+    }
+
+private:
+    std::mutex mx_;
+    std::queue<T> values_;
+    std::counting_semaphore<> available_{0};
+};
+
+// Messages carry their push time in nanoseconds; 0 tells a consumer to stop.
+using message = std::uint64_t;
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+struct result {
+    double messages_per_second;
+    double p50_us, p99_us, p999_us;
+};
+
+template <typename Queue>
+result run(Queue& queue, unsigned producers, unsigned consumers, std::size_t messages) {
+    const std::size_t per_producer = messages / producers;
+    std::vector<std::vector<std::uint64_t>> latencies(consumers);
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (unsigned c = 0; c < consumers; ++c) {
+            threads.emplace_back([&queue, &latency = latencies[c], per_consumer = messages / consumers] {
+                latency.reserve(per_consumer + per_consumer / 4);
+                for (message m; (m = queue.pop()) != 0;) {
+                    latency.push_back(now_ns() - m);
+                }
+            });
+        }
+        std::vector<std::jthread> senders;
+        for (unsigned p = 0; p < producers; ++p) {
+            senders.emplace_back([&queue, per_producer] {
+                for (std::size_t i = 0; i < per_producer; ++i) {
+                    queue.push(now_ns());
+                }
+            });
+        }
+        senders.clear();
+        for (unsigned c = 0; c < consumers; ++c) {
+            queue.push(0);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<std::uint64_t> all;
+    for (const auto& l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    auto percentile = [&all](double p) {
+        auto nth = all.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(all.size() - 1));
+        std::nth_element(all.begin(), nth, all.end());
+        return static_cast<double>(*nth) / 1000.0;
+    };
+    return {static_cast<double>(all.size()) / seconds, percentile(0.50), percentile(0.99), percentile(0.999)};
+}
+
+void print(const char* name, const result& r) {
+    std::cout << "  " << std::left << std::setw(18) << name << std::right << std::setw(7) << std::fixed
+              << std::setprecision(2) << r.messages_per_second / 1e6 << " M msg/s   latency p50 " << std::setw(9)
+              << std::setprecision(1) << r.p50_us << " us, p99 " << std::setw(9) << r.p99_us << " us, p99.9 "
+              << std::setw(9) << r.p999_us << " us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t messages = argc > 1 ? std::stoull(argv[1]) : 400'000;
+    unsigned max_side = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 64;
+    max_side = std::min(max_side, max_threads / 2 - 1);
+    if (max_side == 0 || messages < max_side) {
+        std::cerr << "need at least one producer and at least one message per producer" << std::endl;
+        return 1;
+    }
+
+    std::cout << "producers = consumers, " << messages << " messages, " << std::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+    for (unsigned n = 1; n <= max_side; n *= 2) {
+        std::cout << n << " x " << n << std::endl;
+        {
+            mutex_semaphore_queue<message> q;
+            print("mutex+semaphore", run(q, n, n, messages));
+        }
+        {
+            bounded_queue<message> q(1024);
+            print("bounded (Vyukov)", run(q, n, n, messages));
+        }
+        {
+            segmented_queue<message> q;
+            print("segmented", run(q, n, n, messages));
+        }
+    }
+    return 0;
+}
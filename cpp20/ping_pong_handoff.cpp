@@ -0,0 +1,275 @@
+// Thread-to-thread handoff latency, starting from the binary_semaphore
+// example in concurrency.md (inReady/doneReady). Two threads pinned to a
+// chosen pair of logical CPUs bounce a token back and forth; the round-trip
+// time is the cost of two wake-ups. Compared:
+//  - std::binary_semaphore, as in the example;
+//  - std::mutex + std::condition_variable + flag;
+//  - std::atomic<>::wait/notify_one;
+//  - adaptive_event: spin with a pause instruction, then yield, then park
+//    on a futex, and only make a system call to wake a parked waiter.
+// CPU pairs are taken from /sys/devices/system/cpu: the same logical CPU,
+// SMT siblings of one core, two cores of one socket and two sockets, as far
+// as the machine has them.
+// Build: g++ -std=c++20 -O2 -pthread ping_pong_handoff.cpp   (Linux)
+// Usage: ./a.out [round trips]   (default 100'000)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <vector>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void futex_wake_one(std::atomic<std::uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+// A binary event for one waiter, signalled at most once per wait. A waiter
+// that is about to park marks the word as parked first, so signal() knows
+// whether it must enter the kernel. The spin phase is bounded in time rather
+// than iterations, since one pause takes 10 cycles on some cores and 140 on
+// others; it catches a partner running on another core, and the yield phase
+// a partner waiting for this one.
+class adaptive_event {
+public:
+    void signal() {
+        if (state_.exchange(signaled, std::memory_order_release) == parked) {
+            futex_wake_one(state_);
+        }
+    }
+
+    void wait() {
+        // With a single CPU the partner cannot run while this thread spins.
+        static const bool spin = std::thread::hardware_concurrency() > 1;
+        const auto spin_until = std::chrono::steady_clock::now() + spin_time;
+        while (spin && std::chrono::steady_clock::now() < spin_until) {
+            for (int i = 0; i < 16; ++i) {
+                if (try_consume()) {
+                    return;
+                }
+                cpu_relax();
+            }
+        }
+        for (int i = 0; i < yields; ++i) {
+            if (try_consume()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        while (!try_consume()) {
+            std::uint32_t expected = empty;
+            if (state_.compare_exchange_strong(expected, parked, std::memory_order_acquire) || expected == parked) {
+                futex_wait(state_, parked);
+            }
+        }
+    }
+
+private:
+    enum : std::uint32_t { empty, signaled, parked };
+    static constexpr std::chrono::nanoseconds spin_time{2000};
+    static constexpr int yields = 16;
+
+    bool try_consume() {
+        if (state_.load(std::memory_order_relaxed) != signaled) {
+            return false;
+        }
+        state_.store(empty, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    std::atomic<std::uint32_t> state_{empty};
+};
+
+class semaphore_event {
+public:
+    void signal() { sem_.release(); }
+    void wait() { sem_.acquire(); }
+
+private:
+    std::binary_semaphore sem_{0};
+};
+
+class condition_variable_event {
+public:
+    void signal() {
+        {
+            std::lock_guard lock{mx_};
+            ready_ = true;
+        }
+        cv_.notify_one();
+    }
+    void wait() {
+        std::unique_lock lock{mx_};
+        cv_.wait(lock, [this] { return ready_; });
+        ready_ = false;
+    }
+
+private:
+    std::mutex mx_;
+    std::condition_variable cv_;
+    bool ready_ = false;
+};
+
+class atomic_wait_event {
+public:
+    void signal() {
+        flag_.store(1, std::memory_order_release);
+        flag_.notify_one();
+    }
+    void wait() {
+        while (flag_.exchange(0, std::memory_order_acquire) == 0) {
+            flag_.wait(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<std::uint32_t> flag_{0};
+};
+
+bool pin_to(int cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+struct latency {
+    double p50_ns, p99_ns, max_ns;
+};
+
+template <typename Event>
+std::optional<latency> ping_pong(int cpu_a, int cpu_b, std::size_t round_trips) {
+    struct alignas(64) padded {
+        Event event;
+    };
+    padded ping, pong;
+    std::vector<double> samples(round_trips);
+    bool pinned_a = false, pinned_b = false;
+
+    std::jthread b([&] {
+        pinned_b = pin_to(cpu_b);
+        for (std::size_t i = 0; i < round_trips + 100; ++i) {
+            ping.event.wait();
+            pong.event.signal();
+        }
+    });
+    std::jthread a([&] {
+        pinned_a = pin_to(cpu_a);
+        for (int i = 0; i < 100; ++i) {  // warm up
+            ping.event.signal();
+            pong.event.wait();
+        }
+        for (double& sample : samples) {
+            auto start = std::chrono::steady_clock::now();
+            ping.event.signal();
+            pong.event.wait();
+            sample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+    });
+    a.join();
+    b.join();
+    if (!pinned_a || !pinned_b) {
+        return std::nullopt;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) { return samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))]; };
+    return latency{at(0.50), at(0.99), samples.back()};
+}
+
+int read_topology(int cpu, const char* field) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + field);
+    int value = -1;
+    in >> value;
+    return value;
+}
+
+struct cpu_pair {
+    const char* name;
+    int a, b;
+};
+
+// CPU 0 paired with the first CPU of each kind of neighbour.
+std::vector<cpu_pair> find_pairs() {
+    std::vector<cpu_pair> pairs{{"same logical CPU", 0, 0}};
+    const int cpus = static_cast<int>(std::thread::hardware_concurrency());
+    const int core0 = read_topology(0, "core_id");
+    const int package0 = read_topology(0, "physical_package_id");
+    int smt = -1, socket = -1, remote = -1;
+    for (int cpu = 1; cpu < cpus; ++cpu) {
+        int core = read_topology(cpu, "core_id");
+        int package = read_topology(cpu, "physical_package_id");
+        if (package == package0 && core == core0 && smt < 0) {
+            smt = cpu;
+        } else if (package == package0 && core != core0 && socket < 0) {
+            socket = cpu;
+        } else if (package != package0 && remote < 0) {
+            remote = cpu;
+        }
+    }
+    if (smt >= 0) {
+        pairs.push_back({"SMT siblings", 0, smt});
+    }
+    if (socket >= 0) {
+        pairs.push_back({"same socket", 0, socket});
+    }
+    if (remote >= 0) {
+        pairs.push_back({"cross socket", 0, remote});
+    }
+    return pairs;
+}
+
+template <typename Event>
+void report(const char* name, const cpu_pair& pair, std::size_t round_trips) {
+    std::cout << "    " << std::left << std::setw(20) << name << std::right;
+    if (auto l = ping_pong<Event>(pair.a, pair.b, round_trips)) {
+        std::cout << "round trip p50 " << std::setw(8) << l->p50_ns << " ns, p99 " << std::setw(8) << l->p99_ns
+                  << " ns, max " << std::setw(9) << l->max_ns << " ns" << std::endl;
+    } else {
+        std::cout << "could not pin to CPUs " << pair.a << " and " << pair.b << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t round_trips = argc > 1 ? std::stoull(argv[1]) : 100'000;
+    if (round_trips == 0) {
+        std::cerr << "round trips must be at least 1" << std::endl;
+        return 1;
+    }
+    std::cout << std::fixed << std::setprecision(0);
+    for (const cpu_pair& pair : find_pairs()) {
+        std::cout << pair.name << " (CPU " << pair.a << " <-> CPU " << pair.b << ")" << std::endl;
+        report<semaphore_event>("binary_semaphore", pair, round_trips);
+        report<condition_variable_event>("condition_variable", pair, round_trips);
+        report<atomic_wait_event>("atomic::wait", pair, round_trips);
+        report<adaptive_event>("adaptive_event", pair, round_trips);
+    }
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Sharded counters instead of std::atomic_ref decrements on a shared array
+// (exampleAtomicRef in concurrency.md, which also shares one std::mt19937
+// between threads, a data race). Each writer thread owns a cache-line-aligned
+// shard of deltas and updates it with plain relaxed loads and stores, so no
+// update ever takes a locked instruction or bounces a cache line. Readers
+// choose between
+//  - approximate(i): a snapshot that merge() refreshes periodically, one load;
+//  - exact(i): the initial value plus every shard's delta at the time of the
+//    call, one load per shard.
+// Every worker draws indices from its own RNG stream.
+// Build: g++ -std=c++20 -O2 -pthread sharded_counters.cpp
+// Usage: ./a.out [updates per thread] [threads]   (default 5'000'000, 10)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr std::size_t cache_line = 64;
+
+class sharded_counters {
+    static constexpr std::size_t per_line = cache_line / sizeof(std::int64_t);
+    struct alignas(cache_line) line {
+        std::atomic<std::int64_t> v[per_line];
+    };
+
+public:
+    sharded_counters(std::size_t n, std::int64_t initial, unsigned max_writers)
+        : size_(n), initial_(initial), lines_per_shard_((n + per_line - 1) / per_line), max_writers_(max_writers),
+          shards_(new line[lines_per_shard_ * max_writers]()), snapshot_(new line[lines_per_shard_]()) {
+        for (std::size_t i = 0; i < n; ++i) {
+            slot(snapshot_.get(), i).store(initial, std::memory_order_relaxed);
+        }
+    }
+
+    // The update handle of one thread. Only its owner writes to the shard, so
+    // an update is a load and a store rather than a read-modify-write.
+    class writer {
+    public:
+        void add(std::size_t i, std::int64_t delta) {
+            std::atomic<std::int64_t>& c = slot(shard_, i);
+            c.store(c.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+        void decrement(std::size_t i) { add(i, -1); }
+
+    private:
+        friend class sharded_counters;
+        explicit writer(line* shard) : shard_(shard) {}
+        line* shard_;
+    };
+
+    writer make_writer() {
+        unsigned s = writers_.fetch_add(1, std::memory_order_relaxed);
+        if (s >= max_writers_) {
+            throw std::length_error("sharded_counters: more than " + std::to_string(max_writers_) + " writers");
+        }
+        return writer{shards_.get() + s * lines_per_shard_};
+    }
+
+    std::size_t size() const { return size_; }
+
+    std::int64_t exact(std::size_t i) const {
+        std::int64_t sum = initial_;
+        for (unsigned s = 0; s < writer_count(); ++s) {
+            sum += slot(shards_.get() + s * lines_per_shard_, i).load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    std::int64_t approximate(std::size_t i) const { return slot(snapshot_.get(), i).load(std::memory_order_relaxed); }
+
+    // Publishes the exact values to the snapshot, line by line so that each
+    // snapshot line is written once per merge.
+    void merge() {
+        const unsigned writers = writer_count();
+        for (std::size_t l = 0; l < lines_per_shard_; ++l) {
+            std::int64_t sums[per_line];
+            std::fill_n(sums, per_line, initial_);
+            for (unsigned s = 0; s < writers; ++s) {
+                const line& shard_line = shards_[s * lines_per_shard_ + l];
+                for (std::size_t k = 0; k < per_line; ++k) {
+                    sums[k] += shard_line.v[k].load(std::memory_order_relaxed);
+                }
+            }
+            for (std::size_t k = 0; k < per_line; ++k) {
+                snapshot_[l].v[k].store(sums[k], std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Runs merge() every interval until the returned thread is stopped.
+    std::jthread merge_every(std::chrono::microseconds interval) {
+        return std::jthread{[this, interval](std::stop_token st) {
+            while (!st.stop_requested()) {
+                merge();
+                std::this_thread::sleep_for(interval);
+            }
+        }};
+    }
+
+private:
+    unsigned writer_count() const { return std::min(writers_.load(std::memory_order_relaxed), max_writers_); }
+
+    static std::atomic<std::int64_t>& slot(line* lines, std::size_t i) { return lines[i / per_line].v[i % per_line]; }
+    static const std::atomic<std::int64_t>& slot(const line* lines, std::size_t i) {
+        return lines[i / per_line].v[i % per_line];
+    }
+
+    std::size_t size_;
+    std::int64_t initial_;
+    std::size_t lines_per_shard_;
+    unsigned max_writers_;
+    std::unique_ptr<line[]> shards_;
+    std::unique_ptr<line[]> snapshot_;
+    alignas(cache_line) std::atomic<unsigned> writers_{0};
+};
+
+// Where the threads of a benchmark update:
+//  - hot: everyone the same counter;
+//  - random: uniformly over the whole array, as in exampleAtomicRef;
+//  - disjoint: each thread its own counters, starting on its own cache line.
+enum class layout { hot, random, disjoint };
+
+const char* name(layout l) {
+    switch (l) {
+    case layout::hot:
+        return "hot";
+    case layout::random:
+        return "random";
+    case layout::disjoint:
+        return "disjoint";
+    }
+    return "";
+}
+
+constexpr std::size_t counters = 1000;
+constexpr std::int64_t initial_value = 100;
+// Disjoint ranges are a multiple of this many counters wide, which limits
+// the thread count for that layout only.
+constexpr std::size_t stride = cache_line / sizeof(int);
+constexpr std::size_t max_threads = counters / stride;
+
+// The index generator of thread t: its own mt19937 stream, seeded from t.
+struct index_stream {
+    index_stream(unsigned t, unsigned threads, layout l) : dis(0, counters - 1) {
+        std::seed_seq seed{20200u, t};
+        gen.seed(seed);
+        if (l == layout::hot) {
+            dis = std::uniform_int_distribution<std::size_t>(0, 0);
+        } else if (l == layout::disjoint) {
+            std::size_t width = counters / threads / stride * stride;
+            std::size_t first = t * width;
+            dis = std::uniform_int_distribution<std::size_t>(first, first + std::min<std::size_t>(width, 8) - 1);
+        }
+    }
+    std::size_t operator()() { return dis(gen); }
+
+    std::mt19937 gen;
+    std::uniform_int_distribution<std::size_t> dis;
+};
+
+struct result {
+    double updates_per_second;
+    std::int64_t total;
+    std::size_t zero_seen;
+};
+
+template <typename Body>
+double time_threads(unsigned threads, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back(body, t);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+result run_atomic_ref(layout l, unsigned threads, std::size_t updates) {
+    struct alignas(cache_line) aligned_counters {
+        std::array<int, counters> values;
+    };
+    auto storage = std::make_unique<aligned_counters>();
+    std::array<int, counters>& values = storage->values;
+    values.fill(initial_value);
+    std::atomic<std::size_t> zero_seen{0};
+    double seconds = time_threads(threads, [&](unsigned t) {
+        index_stream next(t, threads, l);
+        std::size_t zeros = 0;
+        for (std::size_t u = 0; u < updates; ++u) {
+            std::atomic_ref<int> val{values[next()]};
+            if (--val <= 0) {
+                ++zeros;
+            }
+        }
+        zero_seen += zeros;
+    });
+    std::int64_t total = 0;
+    for (int v : values) {
+        total += v;
+    }
+    return {static_cast<double>(updates) * threads / seconds, total, zero_seen.load()};
+}
+
+result run_sharded(layout l, unsigned threads, std::size_t updates) {
+    sharded_counters values(counters, initial_value, threads);
+    std::atomic<std::size_t> zero_seen{0};
+    double seconds;
+    {
+        std::jthread merger = values.merge_every(std::chrono::milliseconds(1));
+        seconds = time_threads(threads, [&](unsigned t) {
+            index_stream next(t, threads, l);
+            sharded_counters::writer w = values.make_writer();
+            std::size_t zeros = 0;
+            for (std::size_t u = 0; u < updates; ++u) {
+                std::size_t i = next();
+                w.decrement(i);
+                if (values.approximate(i) <= 0) {
+                    ++zeros;
+                }
+            }
+            zero_seen += zeros;
+        });
+    }
+    std::int64_t total = 0;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        total += values.exact(i);
+    }
+    return {static_cast<double>(updates) * threads / seconds, total, zero_seen.load()};
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t updates = argc > 1 ? std::stoull(argv[1]) : 5'000'000;
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 10;
+    if (threads == 0) {
+        std::cerr << "threads must be at least 1" << std::endl;
+        return 1;
+    }
+    const std::int64_t expected =
+        static_cast<std::int64_t>(counters) * initial_value - static_cast<std::int64_t>(updates * threads);
+
+    std::cout << threads << " threads x " << updates << " decrements over " << counters << " counters, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    for (layout l : {layout::hot, layout::random, layout::disjoint}) {
+        if (l == layout::disjoint && threads > max_threads) {
+            std::cout << "  disjoint skipped: at most " << max_threads << " threads get a cache line each" << std::endl;
+            continue;
+        }
+        for (bool sharded : {false, true}) {
+            result r = sharded ? run_sharded(l, threads, updates) : run_atomic_ref(l, threads, updates);
+            std::cout << "  " << std::left << std::setw(9) << name(l) << std::setw(11)
+                      << (sharded ? "sharded" : "atomic_ref") << std::right << std::setw(8) << std::fixed
+                      << std::setprecision(1) << r.updates_per_second / 1e6 << " M updates/s   "
+                      << (r.total == expected ? "exact total ok" : "TOTAL MISMATCH") << ", " << r.zero_seen
+                      << " updates saw <= 0" << std::endl;
+        }
+    }
+    return 0;
+}
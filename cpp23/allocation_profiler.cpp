@@ -0,0 +1,215 @@
+// Sampling heap profiler: replaces global operator new/delete, samples on
+// average one allocation per `sampling_rate` bytes (Poisson process, as in
+// tcmalloc), records the stack with std::stacktrace and writes a heap profile
+// in the gperftools "heap_v2" text format that pprof reads:
+//     pprof --text ./a.out heap.prof
+// Build: g++ -std=c++23 -O2 allocation_profiler.cpp -lstdc++exp
+// Usage: ./a.out [iterations]   (default 5'000'000)
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stacktrace>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace heap_profiler {
+
+struct site {
+    std::vector<std::uintptr_t> frames;
+    std::int64_t live_count = 0;
+    std::int64_t live_bytes = 0;
+    std::int64_t total_count = 0;
+    std::int64_t total_bytes = 0;
+};
+
+// Every block carries a 16-byte header (keeping the default new alignment)
+// that points at its site when the block was sampled. delete can then tell a
+// sampled block apart without a lookup.
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) header {
+    site* sampled;
+    std::size_t size;
+};
+
+std::atomic<std::int64_t> sampling_rate{0};  // 0 disables sampling
+std::mutex sites_mx;
+std::unordered_map<std::uint64_t, site>* sites;
+
+// Set while the profiler itself allocates, so its own allocations are not sampled.
+thread_local bool busy = false;
+thread_local std::int64_t bytes_until_sample = 0;
+thread_local std::uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+// Exponentially distributed gap with the given mean, so the sampled
+// allocations form a Poisson process over allocated bytes.
+std::int64_t next_gap(std::int64_t mean) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    double u = (static_cast<double>(rng_state >> 11) + 0.5) * 0x1.0p-53;
+    return static_cast<std::int64_t>(-std::log(u) * static_cast<double>(mean)) + 1;
+}
+
+site* record(std::size_t size) {
+    busy = true;
+    auto trace = std::stacktrace::current(2, 64);
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const std::stacktrace_entry& frame : trace) {
+        hash = (hash ^ frame.native_handle()) * 0x100000001b3ULL;
+    }
+    site* s;
+    {
+        std::lock_guard lock{sites_mx};
+        if (!sites) {
+            sites = new std::unordered_map<std::uint64_t, site>;
+        }
+        s = &(*sites)[hash];
+        if (s->frames.empty()) {
+            for (const std::stacktrace_entry& frame : trace) {
+                s->frames.push_back(frame.native_handle());
+            }
+        }
+        ++s->live_count;
+        ++s->total_count;
+        s->live_bytes += static_cast<std::int64_t>(size);
+        s->total_bytes += static_cast<std::int64_t>(size);
+    }
+    busy = false;
+    return s;
+}
+
+void* allocate(std::size_t size) {
+    void* raw = std::malloc(sizeof(header) + size);
+    if (!raw) {
+        throw std::bad_alloc();
+    }
+    header* h = static_cast<header*>(raw);
+    h->sampled = nullptr;
+    h->size = size;
+    std::int64_t rate = sampling_rate.load(std::memory_order_relaxed);
+    if (rate != 0 && !busy) {
+        bytes_until_sample -= static_cast<std::int64_t>(size);
+        if (bytes_until_sample <= 0) {
+            bytes_until_sample = next_gap(rate);
+            h->sampled = record(size);
+        }
+    }
+    return h + 1;
+}
+
+void deallocate(void* p) noexcept {
+    if (!p) {
+        return;
+    }
+    header* h = static_cast<header*>(p) - 1;
+    if (h->sampled) {
+        std::lock_guard lock{sites_mx};
+        --h->sampled->live_count;
+        h->sampled->live_bytes -= static_cast<std::int64_t>(h->size);
+    }
+    std::free(h);
+}
+
+void start(std::int64_t rate) {
+    bytes_until_sample = next_gap(rate);
+    sampling_rate = rate;
+}
+
+void stop() { sampling_rate = 0; }
+
+// Counts are the raw samples; pprof unsamples them using the rate in the
+// "heap_v2/<rate>" header.
+void write_profile(const std::string& path) {
+    busy = true;
+    std::ofstream out(path);
+    std::int64_t live_count = 0, live_bytes = 0, total_count = 0, total_bytes = 0;
+    std::lock_guard lock{sites_mx};
+    if (sites) {
+        for (const auto& [hash, s] : *sites) {
+            live_count += s.live_count;
+            live_bytes += s.live_bytes;
+            total_count += s.total_count;
+            total_bytes += s.total_bytes;
+        }
+    }
+    out << "heap profile: " << live_count << ": " << live_bytes << " [" << total_count << ": " << total_bytes
+        << "] @ heap_v2/" << sampling_rate.load() << "\n";
+    if (sites) {
+        for (const auto& [hash, s] : *sites) {
+            out << s.live_count << ": " << s.live_bytes << " [" << s.total_count << ": " << s.total_bytes << "] @";
+            for (std::uintptr_t pc : s.frames) {
+                out << " 0x" << std::hex << pc << std::dec;
+            }
+            out << "\n";
+        }
+    }
+    out << "\nMAPPED_LIBRARIES:\n" << std::ifstream("/proc/self/maps").rdbuf();
+    busy = false;
+}
+
+} // namespace heap_profiler
+
+void* operator new(std::size_t size) { return heap_profiler::allocate(size); }
+void* operator new[](std::size_t size) { return heap_profiler::allocate(size); }
+void operator delete(void* p) noexcept { heap_profiler::deallocate(p); }
+void operator delete[](void* p) noexcept { heap_profiler::deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { heap_profiler::deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { heap_profiler::deallocate(p); }
+
+// Allocation-heavy work in the spirit of the smart pointer and container
+// examples: small unique_ptrs, growing vectors and short strings.
+[[gnu::noinline]] std::int64_t make_pointers(int n) {
+    std::int64_t sum = 0;
+    for (int i = 0; i < n; ++i) {
+        auto p = std::make_unique<int>(i);
+        sum += *p;
+    }
+    return sum;
+}
+
+[[gnu::noinline]] std::vector<std::string> make_strings(int n) {
+    std::vector<std::string> names;
+    for (int i = 0; i < n; ++i) {
+        names.push_back("request-" + std::to_string(i) + "-with-a-long-suffix");
+    }
+    return names;
+}
+
+std::vector<std::vector<std::string>> kept;
+
+double workload(int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    std::int64_t sum = 0;
+    for (int i = 0; i < iterations / 1000; ++i) {
+        sum += make_pointers(500);
+        auto strings = make_strings(500);
+        if (i % 100 == 0) {
+            kept.push_back(std::move(strings));
+        }
+    }
+    asm volatile("" ::"r"(sum));
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 5'000'000;
+
+    workload(iterations / 10);  // warm up
+    double off = workload(iterations);
+    heap_profiler::start(512 * 1024);
+    double on = workload(iterations);
+    heap_profiler::write_profile("heap.prof");
+    heap_profiler::stop();
+
+    std::cout << "sampling off: " << off << " s" << std::endl;
+    std::cout << "sampling on:  " << on << " s (" << (on / off - 1) * 100 << "% overhead)" << std::endl;
+    std::cout << "wrote heap.prof; inspect with: pprof --text " << argv[0] << " heap.prof" << std::endl;
+    return 0;
+}
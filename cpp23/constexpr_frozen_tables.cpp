@@ -0,0 +1,337 @@
+// Configuration text embedded in the binary and parsed entirely at compile
+// time. The parser works on constexpr std::vector and std::string like any
+// runtime parser would; its result is then frozen into static constexpr
+// arrays (a character pool, an entry table and a perfect hash), so the
+// program starts with the table ready and never parses anything.
+// Build: g++ -std=c++23 -O2 constexpr_frozen_tables.cpp
+// Usage: ./a.out [lookups]   (default 20'000'000)
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// "<METHOD> <path> <handler>" per line; '#' starts a comment. Methods are
+// case-insensitive and trailing slashes are ignored, so keys are normalized
+// to "GET /users".
+constexpr std::string_view routes_config() {
+    return R"(
+# method  path                       handler
+GET       /                          index
+GET       /health                    health_check
+GET       /metrics                   export_metrics
+GET       /users                     list_users
+POST      /users                     create_user
+GET       /users/me                  current_user
+PUT       /users/me                  update_current_user
+DELETE    /users/me                  delete_current_user
+GET       /users/me/sessions         list_sessions
+DELETE    /users/me/sessions         revoke_sessions
+GET       /orders                    list_orders
+POST      /orders                    create_order
+GET       /orders/pending            pending_orders
+GET       /orders/archive            archived_orders
+POST      /orders/import             import_orders
+GET       /orders/export             export_orders
+GET       /products                  list_products
+POST      /products                  create_product
+GET       /products/search           search_products
+GET       /products/categories       list_categories
+POST      /products/categories       create_category
+GET       /cart                      show_cart
+POST      /cart/items                add_cart_item
+delete    /cart/items/               clear_cart
+POST      /cart/checkout             checkout
+GET       /payments                  list_payments
+POST      /payments/refunds          create_refund
+GET       /payments/refunds          list_refunds
+POST      /webhooks/stripe           stripe_webhook
+POST      /webhooks/github           github_webhook
+GET       /admin                     admin_dashboard
+GET       /admin/users               admin_users
+GET       /admin/audit               audit_log
+POST      /admin/cache/flush         flush_cache
+GET       /admin/flags               list_feature_flags
+put       /admin/flags               update_feature_flags
+GET       /search                    global_search
+GET       /notifications             list_notifications
+POST      /notifications/read        mark_notifications_read
+GET       /settings                  show_settings
+PATCH     /settings                  patch_settings
+GET       /reports/daily             daily_report
+GET       /reports/monthly           monthly_report
+POST      /reports/custom            custom_report
+GET       /docs                      api_docs
+GET       /docs/openapi.json         openapi_spec
+POST      /auth/login                login
+POST      /auth/logout               logout
+POST      /auth/refresh              refresh_token
+)";
+}
+
+struct parsed_route {
+    std::string key;      // "GET /users"
+    std::string handler;
+};
+
+// An ordinary parser; used at compile time by freeze() and at run time by the
+// startup benchmark.
+constexpr std::vector<parsed_route> parse_routes(std::string_view text) {
+    std::vector<parsed_route> routes;
+    while (!text.empty()) {
+        std::size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+
+        std::vector<std::string> fields;
+        for (std::size_t i = 0; i < line.size() && line[i] != '#';) {
+            if (line[i] == ' ' || line[i] == '\t' || line[i] == '\r') {
+                ++i;
+                continue;
+            }
+            std::size_t end = i;
+            while (end < line.size() && line[end] != ' ' && line[end] != '\t' && line[end] != '\r') {
+                ++end;
+            }
+            fields.emplace_back(line.substr(i, end - i));
+            i = end;
+        }
+        if (fields.empty()) {
+            continue;
+        }
+        if (fields.size() != 3) {
+            throw std::invalid_argument("route line needs method, path and handler");
+        }
+        std::string key = std::move(fields[0]);
+        for (char& c : key) {
+            c = c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+        std::string& path = fields[1];
+        while (path.size() > 1 && path.back() == '/') {
+            path.pop_back();
+        }
+        key += ' ';
+        key += path;
+        routes.push_back({std::move(key), std::move(fields[2])});
+    }
+    return routes;
+}
+
+// Little-endian 8-byte load; memcpy at run time, byte assembly in constant
+// evaluation where memcpy is not allowed.
+constexpr std::uint64_t load8(const char* p) {
+    if consteval {
+        std::uint64_t word = 0;
+        for (std::size_t b = 0; b < 8; ++b) {
+            word |= std::uint64_t{static_cast<unsigned char>(p[b])} << (8 * b);
+        }
+        return word;
+    } else {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        return word;
+    }
+}
+
+// Eight bytes per multiply. Keys of 8 bytes or more end with an overlapping
+// load of their last 8 bytes instead of a byte-by-byte tail.
+constexpr std::uint64_t hash(std::string_view key) {
+    std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ key.size();
+    std::uint64_t tail = 0;
+    if (key.size() >= 8) {
+        for (std::size_t i = 0; i + 8 < key.size(); i += 8) {
+            h = std::rotl((h ^ load8(key.data() + i)) * 0xff51afd7ed558ccdULL, 29);
+        }
+        tail = load8(key.data() + key.size() - 8);
+    } else {
+        for (std::size_t b = 0; b < key.size(); ++b) {
+            tail |= std::uint64_t{static_cast<unsigned char>(key[b])} << (8 * b);
+        }
+    }
+    h = (h ^ tail) * 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 32);
+}
+
+// Picks a slot from the key's hash and its bucket's seed.
+constexpr std::size_t displace(std::uint64_t h, std::uint64_t seed) {
+    h ^= (seed + 1) * 0x9e3779b97f4a7c15ULL;
+    h *= 0xff51afd7ed558ccdULL;
+    return static_cast<std::size_t>(h >> 32);
+}
+
+struct frozen_entry {
+    std::uint32_t key_offset;
+    std::uint16_t key_size;
+    std::uint16_t handler_size;  // the handler follows the key in the pool
+};
+
+// Hash and displace: keys are grouped into buckets by one hash; buckets are
+// placed largest first, each trying seeds until all its keys land in free
+// slots. Lookup is one hash of the key, two array reads and one key comparison.
+template <std::size_t N, std::size_t PoolSize>
+struct frozen_table {
+    static constexpr std::size_t buckets = N / 4 + 1;
+    static constexpr std::size_t slots = std::bit_ceil(N + N / 4 + 1);
+
+    std::array<char, PoolSize> pool{};
+    std::array<frozen_entry, N> entries{};
+    std::array<std::uint16_t, buckets> seeds{};
+    std::array<std::int16_t, slots> slot_entry{};
+
+    constexpr std::string_view key(std::size_t i) const {
+        return {pool.data() + entries[i].key_offset, entries[i].key_size};
+    }
+    constexpr std::string_view handler(std::size_t i) const {
+        return {pool.data() + entries[i].key_offset + entries[i].key_size, entries[i].handler_size};
+    }
+
+    // Empty when the key is not in the table.
+    constexpr std::string_view find(std::string_view k) const {
+        std::uint64_t h = hash(k);
+        std::int16_t i = slot_entry[displace(h, seeds[h % buckets]) & (slots - 1)];
+        return i >= 0 && key(static_cast<std::size_t>(i)) == k ? handler(static_cast<std::size_t>(i)) : std::string_view{};
+    }
+};
+
+template <auto Config>
+consteval auto freeze() {
+    constexpr std::size_t n = parse_routes(Config()).size();
+    constexpr std::size_t pool_size = [] {
+        std::size_t size = 0;
+        for (const parsed_route& r : parse_routes(Config())) {
+            size += r.key.size() + r.handler.size();
+        }
+        return size;
+    }();
+    using table_type = frozen_table<n, pool_size>;
+
+    table_type table;
+    std::vector<parsed_route> routes = parse_routes(Config());
+    // Equal keys collide under every seed, so they are rejected before the
+    // seed search, which would otherwise fail with a misleading error.
+    std::vector<std::string_view> keys;
+    for (const parsed_route& r : routes) {
+        keys.push_back(r.key);
+    }
+    std::ranges::sort(keys);
+    if (std::ranges::adjacent_find(keys) != keys.end()) {
+        throw std::logic_error("duplicate route");
+    }
+    std::uint32_t offset = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        table.entries[i] = {offset, static_cast<std::uint16_t>(routes[i].key.size()),
+                            static_cast<std::uint16_t>(routes[i].handler.size())};
+        std::ranges::copy(routes[i].key, table.pool.begin() + offset);
+        offset += static_cast<std::uint32_t>(routes[i].key.size());
+        std::ranges::copy(routes[i].handler, table.pool.begin() + offset);
+        offset += static_cast<std::uint32_t>(routes[i].handler.size());
+    }
+
+    std::vector<std::vector<std::size_t>> bucket_keys(table_type::buckets);
+    for (std::size_t i = 0; i < n; ++i) {
+        bucket_keys[hash(table.key(i)) % table_type::buckets].push_back(i);
+    }
+    std::vector<std::size_t> order(table_type::buckets);
+    for (std::size_t b = 0; b < order.size(); ++b) {
+        order[b] = b;
+    }
+    std::ranges::sort(order, [&](std::size_t a, std::size_t b) {
+        return bucket_keys[a].size() != bucket_keys[b].size() ? bucket_keys[a].size() > bucket_keys[b].size() : a < b;
+    });
+
+    table.slot_entry.fill(-1);
+    for (std::size_t b : order) {
+        for (std::uint16_t seed = 0;; ++seed) {
+            if (seed == UINT16_MAX) {
+                throw std::logic_error("no perfect hash seed found");
+            }
+            std::vector<std::size_t> taken;
+            bool fits = true;
+            for (std::size_t i : bucket_keys[b]) {
+                std::size_t s = displace(hash(table.key(i)), seed) & (table_type::slots - 1);
+                if (table.slot_entry[s] >= 0 || std::ranges::find(taken, s) != taken.end()) {
+                    fits = false;
+                    break;
+                }
+                taken.push_back(s);
+            }
+            if (fits) {
+                for (std::size_t k = 0; k < taken.size(); ++k) {
+                    table.slot_entry[taken[k]] = static_cast<std::int16_t>(bucket_keys[b][k]);
+                }
+                table.seeds[b] = seed;
+                break;
+            }
+        }
+    }
+
+    return table;
+}
+
+static constexpr auto routes = freeze<routes_config>();
+
+static_assert(routes.find("GET /users/me") == "current_user");
+static_assert(routes.find("DELETE /cart/items") == "clear_cart");
+static_assert(routes.find("GET /nowhere").empty());
+
+volatile std::size_t benchmark_sink;
+
+int main(int argc, char* argv[]) {
+    std::size_t lookups = argc > 1 ? std::stoull(argv[1]) : 20'000'000;
+
+    std::cout << routes.entries.size() << " routes frozen into " << sizeof(routes) << " bytes ("
+              << routes.slots << " slots, " << routes.buckets << " buckets)" << std::endl;
+    std::cout << "PUT /admin/flags -> " << routes.find("PUT /admin/flags") << std::endl;
+
+    // Startup: what the program would otherwise do before serving its first
+    // request.
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, std::string> runtime_routes;
+    for (parsed_route& r : parse_routes(routes_config())) {
+        runtime_routes.emplace(std::move(r.key), std::move(r.handler));
+    }
+    double startup_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "startup: parse into unordered_map " << startup_us << " us, frozen table 0 us" << std::endl;
+
+    // Requests: every route once plus as many misses, in a fixed order.
+    std::vector<std::string> requests;
+    for (std::size_t i = 0; i < routes.entries.size(); ++i) {
+        requests.emplace_back(routes.key(i));
+        requests.push_back(std::string(routes.key(i)) + "/x");
+    }
+    const std::size_t rounds = std::max<std::size_t>(1, lookups / requests.size());
+    const std::size_t total = rounds * requests.size();
+
+    start = std::chrono::steady_clock::now();
+    std::size_t found = 0;
+    for (std::size_t r = 0; r < rounds; ++r) {
+        for (const std::string& request : requests) {
+            found += routes.find(request).size();
+        }
+    }
+    benchmark_sink = found;
+    double frozen_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / total;
+
+    start = std::chrono::steady_clock::now();
+    found = 0;
+    for (std::size_t r = 0; r < rounds; ++r) {
+        for (const std::string& request : requests) {
+            auto it = runtime_routes.find(request);
+            found += it == runtime_routes.end() ? 0 : it->second.size();
+        }
+    }
+    benchmark_sink = found;
+    double map_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / total;
+
+    std::cout << "lookup (50% hits): frozen perfect hash " << frozen_ns << " ns, unordered_map " << map_ns << " ns"
+              << std::endl;
+    return 0;
+}
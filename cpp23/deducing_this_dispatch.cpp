@@ -0,0 +1,271 @@
+// Static polymorphism with explicit object parameters instead of CRTP or
+// virtual functions. A mixin's `this auto& self` deduces the most derived
+// type, so block processing, chaining and state access are resolved at
+// compile time; a small adapter exposes a component through a virtual
+// interface at the few boundaries that need one.
+// Build: g++ -std=c++23 -O2 deducing_this_dispatch.cpp   (GCC 14 / Clang 18)
+// Usage: ./a.out [samples]   (default 50'000'000)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Mixins
+
+// Gives every filter a block loop over its per-sample process().
+struct block_filter {
+    void process_block(this auto& self, std::span<float> samples) {
+        for (float& x : samples) {
+            x = self.process(x);
+        }
+    }
+};
+
+// Gives read access to a component's parameters with the caller's value
+// category: an rvalue component hands its parameters out by move.
+struct with_params {
+    template <typename Self>
+    auto&& params(this Self&& self) {
+        return std::forward<Self>(self).params_;
+    }
+};
+
+// Components
+
+struct gain_params {
+    float gain = 1.0f;
+};
+
+struct gain : block_filter, with_params {
+    gain_params params_;
+
+    explicit gain(float g) : params_{g} {}
+    float process(float x) const { return x * params_.gain; }
+};
+
+struct one_pole_params {
+    float coefficient = 0.5f;
+};
+
+struct one_pole : block_filter, with_params {
+    one_pole_params params_;
+    float state = 0.0f;
+
+    explicit one_pole(float a) : params_{a} {}
+    float process(float x) {
+        state += params_.coefficient * (x - state);
+        return state;
+    }
+};
+
+struct clip : block_filter {
+    float limit;
+
+    explicit clip(float l) : limit(l) {}
+    float process(float x) const { return std::clamp(x, -limit, limit); }
+};
+
+// Runs its stages in order; itself a filter, so chains nest.
+template <typename... Stages>
+struct chain : block_filter {
+    std::tuple<Stages...> stages;
+
+    explicit chain(Stages... s) : stages(std::move(s)...) {}
+    float process(this auto& self, float x) {
+        std::apply([&x](auto&... stage) { ((x = stage.process(x)), ...); }, self.stages);
+        return x;
+    }
+};
+
+// Devirtualized interface
+
+struct filter_interface {
+    virtual ~filter_interface() = default;
+    virtual float process(float x) = 0;
+    virtual void process_block(std::span<float> samples) = 0;
+};
+
+// Wraps any static component behind filter_interface. The block call pays one
+// virtual dispatch per block; inside, everything is statically bound.
+template <typename Filter>
+struct as_interface final : filter_interface {
+    Filter filter;
+
+    explicit as_interface(Filter f) : filter(std::move(f)) {}
+    float process(float x) override { return filter.process(x); }
+    void process_block(std::span<float> samples) override { filter.process_block(samples); }
+};
+
+// Classic virtual hierarchy for comparison.
+struct virtual_gain final : filter_interface {
+    float gain;
+    explicit virtual_gain(float g) : gain(g) {}
+    float process(float x) override { return x * gain; }
+    void process_block(std::span<float> samples) override {
+        for (float& x : samples) {
+            x = process(x);
+        }
+    }
+};
+
+struct virtual_one_pole final : filter_interface {
+    float coefficient, state = 0.0f;
+    explicit virtual_one_pole(float a) : coefficient(a) {}
+    float process(float x) override {
+        state += coefficient * (x - state);
+        return state;
+    }
+    void process_block(std::span<float> samples) override {
+        for (float& x : samples) {
+            x = process(x);
+        }
+    }
+};
+
+struct virtual_clip final : filter_interface {
+    float limit;
+    explicit virtual_clip(float l) : limit(l) {}
+    float process(float x) override { return std::clamp(x, -limit, limit); }
+    void process_block(std::span<float> samples) override {
+        for (float& x : samples) {
+            x = process(x);
+        }
+    }
+};
+
+using any_filter = std::variant<gain, one_pole, clip>;
+
+volatile float benchmark_sink;
+
+template <typename F>
+void run(const char* name, std::size_t samples, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    float sum = f();
+    benchmark_sink = sum;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << name << ns / samples << " ns/sample" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t samples = argc > 1 ? std::stoull(argv[1]) : 50'000'000;
+
+    // A recursive lambda: the explicit object parameter names the lambda itself.
+    auto gcd = [](this auto self, unsigned a, unsigned b) -> unsigned { return b == 0 ? a : self(b, a % b); };
+    std::cout << "gcd(1071, 462) = " << gcd(1071u, 462u) << std::endl;
+
+    gain g{0.5f};
+    g.params().gain = 0.8f;                        // lvalue: gain_params&
+    gain_params moved = gain{2.0f}.params();       // rvalue: gain_params&&
+    std::cout << "gain " << g.params().gain << ", moved " << moved.gain << std::endl;
+
+    std::vector<float> signal(4096);
+    for (std::size_t i = 0; i < signal.size(); ++i) {
+        signal[i] = std::sin(static_cast<float>(i) * 0.01f) * 2.0f;
+    }
+    const std::size_t blocks = std::max<std::size_t>(1, samples / signal.size());
+    const std::size_t total = blocks * signal.size();
+    std::vector<float> work(signal.size());
+
+    std::cout << "gain -> one_pole -> clip over " << total << " samples" << std::endl;
+
+    run("static chain, per sample   ", total, [&] {
+        chain c{gain{0.8f}, one_pole{0.1f}, clip{1.0f}};
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            for (float x : signal) {
+                sum += c.process(x);
+            }
+        }
+        return sum;
+    });
+
+    run("static chain, per block    ", total, [&] {
+        chain c{gain{0.8f}, one_pole{0.1f}, clip{1.0f}};
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            std::ranges::copy(signal, work.begin());
+            c.process_block(work);
+            sum += work.back();
+        }
+        return sum;
+    });
+
+    run("adapter, per block         ", total, [&] {
+        std::unique_ptr<filter_interface> f =
+            std::make_unique<as_interface<chain<gain, one_pole, clip>>>(chain{gain{0.8f}, one_pole{0.1f}, clip{1.0f}});
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            std::ranges::copy(signal, work.begin());
+            f->process_block(work);
+            sum += work.back();
+        }
+        return sum;
+    });
+
+    // Virtual calls through an array of base pointers, as a configurable
+    // pipeline would hold them; the compiler cannot see the concrete types.
+    std::vector<std::unique_ptr<filter_interface>> virtual_chain;
+    virtual_chain.push_back(std::make_unique<virtual_gain>(0.8f));
+    virtual_chain.push_back(std::make_unique<virtual_one_pole>(0.1f));
+    virtual_chain.push_back(std::make_unique<virtual_clip>(1.0f));
+
+    run("virtual, per sample        ", total, [&] {
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            for (float x : signal) {
+                for (auto& f : virtual_chain) {
+                    x = f->process(x);
+                }
+                sum += x;
+            }
+        }
+        return sum;
+    });
+
+    run("virtual, per block         ", total, [&] {
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            std::ranges::copy(signal, work.begin());
+            for (auto& f : virtual_chain) {
+                f->process_block(work);
+            }
+            sum += work.back();
+        }
+        return sum;
+    });
+
+    std::vector<any_filter> variant_chain{gain{0.8f}, one_pole{0.1f}, clip{1.0f}};
+
+    run("std::variant, per sample   ", total, [&] {
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            for (float x : signal) {
+                for (auto& f : variant_chain) {
+                    x = std::visit([x](auto& stage) { return stage.process(x); }, f);
+                }
+                sum += x;
+            }
+        }
+        return sum;
+    });
+
+    run("std::variant, per block    ", total, [&] {
+        float sum = 0;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            std::ranges::copy(signal, work.begin());
+            for (auto& f : variant_chain) {
+                std::visit([&](auto& stage) { stage.process_block(work); }, f);
+            }
+            sum += work.back();
+        }
+        return sum;
+    });
+    return 0;
+}
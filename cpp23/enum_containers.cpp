@@ -0,0 +1,305 @@
+// Dense containers keyed by scoped enums: enum_map<E, T> is an array indexed
+// by std::to_underlying(e) - min, enum_set<E> a fixed bitset. The range of
+// enumerators is found at compile time by probing each candidate value in the
+// compiler's __PRETTY_FUNCTION__ spelling (a named enumerator prints as
+// "Color::Red", anything else as "(Color)3").
+// Build: g++ -std=c++23 -O2 enum_containers.cpp
+// Usage: ./a.out [lookups]   (default 50'000'000)
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Range of underlying values probed for enumerators. Specialize for enums
+// with values outside [-128, 127].
+template <typename E>
+struct enum_range {
+    static constexpr int min = std::is_signed_v<std::underlying_type_t<E>> ? -128 : 0;
+    static constexpr int max = 127;
+};
+
+namespace detail {
+
+template <auto V>
+consteval std::string_view pretty_name() {
+    std::string_view name = __PRETTY_FUNCTION__;
+#if defined(__clang__)
+    name.remove_prefix(name.find("V = ") + 4);
+    name.remove_suffix(1);  // "]"
+#else
+    name.remove_prefix(name.find("V = ") + 4);
+    name = name.substr(0, name.find_first_of(";]"));
+#endif
+    return name;
+}
+
+template <typename E, int V>
+consteval bool is_enumerator() {
+    return pretty_name<static_cast<E>(V)>()[0] != '(';
+}
+
+template <typename E, int... Is>
+consteval auto reflect(std::integer_sequence<int, Is...>) {
+    constexpr int first = enum_range<E>::min;
+    constexpr bool valid[] = {is_enumerator<E, first + Is>()...};
+    constexpr std::size_t count = (std::size_t{valid[Is]} + ... + 0);
+    std::array<E, count> values{};
+    std::size_t i = 0;
+    for (std::size_t v = 0; v < sizeof...(Is); ++v) {
+        if (valid[v]) {
+            values[i++] = static_cast<E>(first + static_cast<int>(v));
+        }
+    }
+    return values;
+}
+
+} // namespace detail
+
+template <typename E>
+    requires std::is_scoped_enum_v<E>
+struct enum_traits {
+    // Every enumerator, in ascending order of value.
+    static constexpr auto values =
+        detail::reflect<E>(std::make_integer_sequence<int, enum_range<E>::max - enum_range<E>::min + 1>{});
+    static_assert(!values.empty(), "no enumerators found in enum_range<E>");
+
+    static constexpr auto min = std::to_underlying(values.front());
+    static constexpr auto max = std::to_underlying(values.back());
+    // Slots between min and max, including values that name no enumerator.
+    static constexpr std::size_t span = static_cast<std::size_t>(max - min) + 1;
+
+    static constexpr std::size_t index(E e) noexcept { return static_cast<std::size_t>(std::to_underlying(e) - min); }
+    static constexpr bool in_range(E e) noexcept { return std::to_underlying(e) >= min && std::to_underlying(e) <= max; }
+};
+
+template <auto V>
+constexpr std::string_view enum_name() {
+    std::string_view name = detail::pretty_name<V>();
+    return name.substr(name.rfind(':') + 1);
+}
+
+template <typename E, typename T>
+class enum_map {
+    using traits = enum_traits<E>;
+
+public:
+    constexpr T& operator[](E e) noexcept { return slots_[traits::index(e)]; }
+    constexpr const T& operator[](E e) const noexcept { return slots_[traits::index(e)]; }
+
+    constexpr T& at(E e) {
+        if (!traits::in_range(e)) {
+            throw std::out_of_range("enum_map::at");
+        }
+        return slots_[traits::index(e)];
+    }
+
+    constexpr void fill(const T& value) { slots_.fill(value); }
+
+    // Calls f(key, value) for every enumerator, in ascending order.
+    template <typename F>
+    constexpr void for_each(F&& f) {
+        for (E e : traits::values) {
+            f(e, slots_[traits::index(e)]);
+        }
+    }
+
+    static constexpr std::size_t size() noexcept { return traits::values.size(); }
+
+private:
+    std::array<T, traits::span> slots_{};
+};
+
+template <typename E>
+class enum_set {
+    using traits = enum_traits<E>;
+    static constexpr std::size_t words = (traits::span + 63) / 64;
+
+public:
+    constexpr enum_set() = default;
+    constexpr enum_set(std::initializer_list<E> values) {
+        for (E e : values) {
+            insert(e);
+        }
+    }
+
+    static constexpr enum_set all() noexcept {
+        enum_set s;
+        for (E e : traits::values) {
+            s.insert(e);
+        }
+        return s;
+    }
+
+    constexpr void insert(E e) noexcept { bits_[traits::index(e) / 64] |= bit(e); }
+    constexpr void erase(E e) noexcept { bits_[traits::index(e) / 64] &= ~bit(e); }
+    constexpr bool contains(E e) const noexcept { return bits_[traits::index(e) / 64] & bit(e); }
+
+    constexpr std::size_t size() const noexcept {
+        std::size_t n = 0;
+        for (std::uint64_t w : bits_) {
+            n += static_cast<std::size_t>(std::popcount(w));
+        }
+        return n;
+    }
+    constexpr bool empty() const noexcept { return size() == 0; }
+
+    constexpr enum_set& operator|=(const enum_set& other) noexcept {
+        for (std::size_t i = 0; i < words; ++i) {
+            bits_[i] |= other.bits_[i];
+        }
+        return *this;
+    }
+    constexpr enum_set& operator&=(const enum_set& other) noexcept {
+        for (std::size_t i = 0; i < words; ++i) {
+            bits_[i] &= other.bits_[i];
+        }
+        return *this;
+    }
+    constexpr enum_set& operator-=(const enum_set& other) noexcept {
+        for (std::size_t i = 0; i < words; ++i) {
+            bits_[i] &= ~other.bits_[i];
+        }
+        return *this;
+    }
+    friend constexpr enum_set operator|(enum_set a, const enum_set& b) noexcept { return a |= b; }
+    friend constexpr enum_set operator&(enum_set a, const enum_set& b) noexcept { return a &= b; }
+    friend constexpr enum_set operator-(enum_set a, const enum_set& b) noexcept { return a -= b; }
+    // Complement within the enumerators, so gaps in the value range stay clear.
+    friend constexpr enum_set operator~(const enum_set& s) noexcept { return all() - s; }
+    friend constexpr bool operator==(const enum_set&, const enum_set&) = default;
+
+    // Calls f(e) for every member, in ascending order.
+    template <typename F>
+    constexpr void for_each(F&& f) const {
+        for (std::size_t i = 0; i < words; ++i) {
+            for (std::uint64_t w = bits_[i]; w != 0; w &= w - 1) {
+                f(static_cast<E>(traits::min + static_cast<int>(i * 64 + std::countr_zero(w))));
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint64_t bit(E e) noexcept { return std::uint64_t{1} << (traits::index(e) % 64); }
+
+    std::array<std::uint64_t, words> bits_{};
+};
+
+enum class Color { Red, Green, Blue };
+
+enum class ConnectionState : std::uint8_t {
+    Idle,
+    Resolving,
+    Connecting,
+    Handshake,
+    Open,
+    Reading,
+    Writing,
+    Draining,
+    Closing,
+    Closed,
+    Failed = 20,  // leaves a gap
+};
+
+static_assert(enum_traits<Color>::values.size() == 3);
+static_assert(enum_traits<ConnectionState>::values.size() == 11 && enum_traits<ConnectionState>::span == 21);
+static_assert((~enum_set<Color>{Color::Red}).size() == 2);
+static_assert(enum_name<Color::Blue>() == "Blue");
+
+volatile std::uint64_t benchmark_sink;
+
+template <typename F>
+void run(const char* name, std::size_t lookups, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    benchmark_sink = f();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << name << ns / lookups << " ns/lookup" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t lookups = argc > 1 ? std::stoull(argv[1]) : 50'000'000;
+
+    enum_map<Color, std::string> hex;
+    hex[Color::Red] = "#ff0000";
+    hex[Color::Green] = "#00ff00";
+    hex[Color::Blue] = "#0000ff";
+    hex.for_each([](Color c, const std::string& h) { std::cout << std::to_underlying(c) << " -> " << h << std::endl; });
+
+    enum_set<ConnectionState> busy{ConnectionState::Resolving, ConnectionState::Connecting, ConnectionState::Reading,
+                                   ConnectionState::Writing};
+    enum_set<ConnectionState> terminal{ConnectionState::Closed, ConnectionState::Failed};
+    std::cout << "neither busy nor terminal:";
+    (~(busy | terminal)).for_each([](ConnectionState s) { std::cout << ' ' << +std::to_underlying(s); });
+    std::cout << std::endl;
+
+    // A stream of state transitions, as a connection pool would see them.
+    const auto& states = enum_traits<ConnectionState>::values;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<std::size_t> pick(0, states.size() - 1);
+    std::vector<ConnectionState> events(4096);
+    for (auto& e : events) {
+        e = states[pick(gen)];
+    }
+
+    std::cout << "per-state counters (" << states.size() << " states):" << std::endl;
+    run("enum_map              ", lookups, [&] {
+        enum_map<ConnectionState, std::uint64_t> counts;
+        for (std::size_t i = 0; i < lookups; ++i) {
+            ++counts[events[i & 4095]];
+        }
+        return counts[ConnectionState::Open];
+    });
+    run("std::unordered_map    ", lookups, [&] {
+        std::unordered_map<ConnectionState, std::uint64_t> counts;
+        for (std::size_t i = 0; i < lookups; ++i) {
+            ++counts[events[i & 4095]];
+        }
+        return counts[ConnectionState::Open];
+    });
+    run("std::map              ", lookups, [&] {
+        std::map<ConnectionState, std::uint64_t> counts;
+        for (std::size_t i = 0; i < lookups; ++i) {
+            ++counts[events[i & 4095]];
+        }
+        return counts[ConnectionState::Open];
+    });
+
+    std::cout << "membership tests:" << std::endl;
+    run("enum_set              ", lookups, [&] {
+        std::uint64_t hits = 0;
+        for (std::size_t i = 0; i < lookups; ++i) {
+            hits += busy.contains(events[i & 4095]);
+        }
+        return hits;
+    });
+    std::unordered_set<ConnectionState> busy_hash{ConnectionState::Resolving, ConnectionState::Connecting,
+                                                  ConnectionState::Reading, ConnectionState::Writing};
+    run("std::unordered_set    ", lookups, [&] {
+        std::uint64_t hits = 0;
+        for (std::size_t i = 0; i < lookups; ++i) {
+            hits += busy_hash.contains(events[i & 4095]);
+        }
+        return hits;
+    });
+    std::set<ConnectionState> busy_tree(busy_hash.begin(), busy_hash.end());
+    run("std::set              ", lookups, [&] {
+        std::uint64_t hits = 0;
+        for (std::size_t i = 0; i < lookups; ++i) {
+            hits += busy_tree.contains(events[i & 4095]);
+        }
+        return hits;
+    });
+    return 0;
+}
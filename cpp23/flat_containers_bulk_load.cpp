@@ -0,0 +1,274 @@
+// Read-mostly lookup tables: a sorted-vector flat map/set with bulk loading,
+// an Eytzinger (BFS-order) copy of the keys and a SIMD-finished lower_bound.
+// Build: g++ -std=c++23 -O2 -march=native flat_containers_bulk_load.cpp -ltbb
+// Usage: ./a.out [max_keys]   (default 1'000'000, try 100'000'000)
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#if __has_include(<flat_map>)
+#include <flat_map>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
+
+// Sorted unique keys plus an Eytzinger layout of the same keys.
+// eytzinger_[k] has children at 2k and 2k+1, so the first levels of every
+// search share the same few cache lines and the next level can be prefetched.
+template <typename Key>
+class flat_index {
+public:
+    std::size_t size() const { return keys_.size(); }
+    const std::vector<Key>& keys() const { return keys_; }
+
+    // Branchless binary search that switches to a SIMD count once the
+    // remaining window fits in 16 keys.
+    std::size_t lower_bound(const Key& key) const {
+        const Key* base = keys_.data();
+        std::size_t lo = 0;
+        std::size_t n = keys_.size();
+        while (n > 16) {
+            std::size_t half = n / 2;
+            lo = (base[lo + half - 1] < key) ? lo + half : lo;
+            n -= half;
+        }
+        return lo + count_less(base + lo, std::min<std::size_t>(16, keys_.size() - lo), key);
+    }
+
+    std::size_t lower_bound_eytzinger(const Key& key) const {
+        const std::size_t n = keys_.size();
+        std::size_t k = 1;
+        while (k <= n) {
+            __builtin_prefetch(eytzinger_.data() + std::min(16 * k, n));
+            k = 2 * k + (eytzinger_[k] < key);
+        }
+        k >>= std::countr_one(k) + 1;
+        return k == 0 ? n : rank_[k];
+    }
+
+protected:
+    void rebuild_index() {
+        eytzinger_.assign(keys_.size() + 1, Key{});
+        rank_.assign(keys_.size() + 1, 0);
+        std::size_t i = 0;
+        build(i, 1);
+    }
+
+    std::vector<Key> keys_;
+
+private:
+    void build(std::size_t& i, std::size_t k) {
+        if (k <= keys_.size()) {
+            build(i, 2 * k);
+            eytzinger_[k] = keys_[i];
+            rank_[k] = static_cast<std::uint32_t>(i++);
+            build(i, 2 * k + 1);
+        }
+    }
+
+    static std::size_t count_less(const Key* first, std::size_t n, const Key& key) {
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<Key, int>) {
+            if (n == 16) {
+                __m256i needle = _mm256_set1_epi32(key);
+                __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+                __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + 8));
+                int mlo = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, lo)));
+                int mhi = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, hi)));
+                return std::popcount(static_cast<unsigned>(mlo | (mhi << 8)));
+            }
+        }
+#endif
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            count += first[i] < key;
+        }
+        return count;
+    }
+
+    std::vector<Key> eytzinger_;
+    std::vector<std::uint32_t> rank_;
+};
+
+template <typename Key>
+class lookup_flat_set : public flat_index<Key> {
+public:
+    explicit lookup_flat_set(std::vector<Key> keys) {
+        std::sort(std::execution::par_unseq, keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        this->keys_ = std::move(keys);
+        this->rebuild_index();
+    }
+
+    lookup_flat_set(sorted_unique_t, std::vector<Key> keys) {
+        this->keys_ = std::move(keys);
+        this->rebuild_index();
+    }
+
+    bool contains(const Key& key) const {
+        std::size_t i = this->lower_bound(key);
+        return i != this->size() && this->keys_[i] == key;
+    }
+};
+
+template <typename Key, typename T>
+class lookup_flat_map : public flat_index<Key> {
+public:
+    // Unsorted input; for duplicate keys the first occurrence wins.
+    explicit lookup_flat_map(std::vector<std::pair<Key, T>> items) {
+        sort_unique(items);
+        split(items, this->keys_, values_);
+        this->rebuild_index();
+    }
+
+    lookup_flat_map(sorted_unique_t, std::vector<Key> keys, std::vector<T> values)
+        : values_(std::move(values)) {
+        this->keys_ = std::move(keys);
+        this->rebuild_index();
+    }
+
+    const T* find(const Key& key) const {
+        std::size_t i = this->lower_bound(key);
+        return i != this->size() && this->keys_[i] == key ? &values_[i] : nullptr;
+    }
+
+    const T* find_eytzinger(const Key& key) const {
+        std::size_t i = this->lower_bound_eytzinger(key);
+        return i != this->size() && this->keys_[i] == key ? &values_[i] : nullptr;
+    }
+
+    // Sorts the batch once and merges it in a single linear pass instead of
+    // paying an O(n) shift per inserted element. Existing keys are kept.
+    void insert_batch(std::vector<std::pair<Key, T>> items) {
+        sort_unique(items);
+        std::vector<Key> keys;
+        std::vector<T> values;
+        keys.reserve(this->keys_.size() + items.size());
+        values.reserve(this->keys_.size() + items.size());
+        std::size_t i = 0, j = 0;
+        while (i < this->keys_.size() || j < items.size()) {
+            if (j == items.size() || (i < this->keys_.size() && !(items[j].first < this->keys_[i]))) {
+                if (j < items.size() && items[j].first == this->keys_[i]) {
+                    ++j;
+                }
+                keys.push_back(std::move(this->keys_[i]));
+                values.push_back(std::move(values_[i++]));
+            } else {
+                keys.push_back(std::move(items[j].first));
+                values.push_back(std::move(items[j++].second));
+            }
+        }
+        this->keys_ = std::move(keys);
+        values_ = std::move(values);
+        this->rebuild_index();
+    }
+
+private:
+    static void sort_unique(std::vector<std::pair<Key, T>>& items) {
+        auto by_key = [](const auto& a, const auto& b) { return a.first < b.first; };
+        std::stable_sort(std::execution::par_unseq, items.begin(), items.end(), by_key);
+        auto same_key = [](const auto& a, const auto& b) { return a.first == b.first; };
+        items.erase(std::unique(items.begin(), items.end(), same_key), items.end());
+    }
+
+    static void split(std::vector<std::pair<Key, T>>& items, std::vector<Key>& keys, std::vector<T>& values) {
+        keys.reserve(items.size());
+        values.reserve(items.size());
+        for (auto& [k, v] : items) {
+            keys.push_back(std::move(k));
+            values.push_back(std::move(v));
+        }
+    }
+
+    std::vector<T> values_;
+};
+
+volatile long long benchmark_sink;
+
+template <typename F>
+double ns_per_lookup(const std::vector<int>& probes, F&& lookup) {
+    auto start = std::chrono::steady_clock::now();
+    long long checksum = 0;
+    for (int key : probes) {
+        checksum += lookup(key);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    benchmark_sink = checksum;
+    return std::chrono::duration<double, std::nano>(stop - start).count() / probes.size();
+}
+
+void benchmark(std::size_t n) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dis(0, static_cast<int>(std::min<std::size_t>(n * 4, 2'000'000'000)));
+    std::vector<std::pair<int, int>> items(n);
+    for (auto& [k, v] : items) {
+        k = dis(gen);
+        v = k / 2;
+    }
+    std::vector<int> probes(1'000'000);
+    for (int& p : probes) {
+        p = dis(gen);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    lookup_flat_map<int, int> flat(items);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << n << " keys (" << flat.size() << " unique), bulk load "
+              << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << std::endl;
+
+    auto hit = [](const int* p) { return p ? *p : 0; };
+    std::cout << "  simd lower_bound   " << ns_per_lookup(probes, [&](int k) { return hit(flat.find(k)); }) << " ns" << std::endl;
+    std::cout << "  eytzinger          " << ns_per_lookup(probes, [&](int k) { return hit(flat.find_eytzinger(k)); }) << " ns" << std::endl;
+    std::cout << "  std::lower_bound   " << ns_per_lookup(probes, [&](int k) {
+        auto it = std::lower_bound(flat.keys().begin(), flat.keys().end(), k);
+        return it != flat.keys().end() && *it == k ? k / 2 : 0;
+    }) << " ns" << std::endl;
+#if __has_include(<flat_map>)
+    std::flat_map<int, int> std_flat(flat.keys(), std::vector<int>(flat.keys().begin(), flat.keys().end()));
+    std::cout << "  std::flat_map      " << ns_per_lookup(probes, [&](int k) {
+        auto it = std_flat.find(k);
+        return it != std_flat.end() ? it->second / 2 : 0;
+    }) << " ns" << std::endl;
+#endif
+    if (n <= 10'000'000) {
+        std::map<int, int> tree(items.begin(), items.end());
+        std::cout << "  std::map           " << ns_per_lookup(probes, [&](int k) {
+            auto it = tree.find(k);
+            return it != tree.end() ? it->second : 0;
+        }) << " ns" << std::endl;
+    }
+    std::unordered_map<int, int> hash(items.begin(), items.end());
+    std::cout << "  std::unordered_map " << ns_per_lookup(probes, [&](int k) {
+        auto it = hash.find(k);
+        return it != hash.end() ? it->second : 0;
+    }) << " ns" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    lookup_flat_map<int, std::string> map({{3, "three"}, {1, "one"}, {2, "two"}, {1, "uno"}});
+    map.insert_batch({{5, "five"}, {2, "deux"}, {4, "four"}});
+    for (std::size_t i = 0; i < map.size(); ++i) {
+        std::cout << map.keys()[i] << ": " << *map.find(map.keys()[i]) << std::endl;
+    }
+    lookup_flat_set<int> set({7, 3, 7, 1});
+    std::cout << "set contains 3: " << set.contains(3) << ", contains 4: " << set.contains(4) << std::endl;
+
+    std::size_t max_keys = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    for (std::size_t n = 1'000; n <= max_keys; n *= 10) {
+        benchmark(n);
+    }
+    return 0;
+}
@@ -0,0 +1,285 @@
+// Format strings compiled at compile time into a writer that formats straight
+// into a caller-provided buffer, with no temporary std::string.
+// Supports "{}" placeholders and "{{" / "}}" escapes; arguments may be
+// integers, floating point (shortest round-trip) or strings.
+// Build: g++ -std=c++23 -O2 formatting_compiled.cpp
+// Usage: ./a.out [iterations]   (default 2'000'000)
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#if __has_include(<format>)
+#include <format>
+#endif
+
+template <std::size_t N>
+struct fixed_string {
+    char data[N]{};
+
+    consteval fixed_string(const char (&s)[N]) {
+        for (std::size_t i = 0; i < N; ++i) {
+            data[i] = s[i];
+        }
+    }
+    constexpr std::string_view view() const { return {data, N - 1}; }
+};
+
+struct segment {
+    std::size_t begin = 0;
+    std::size_t size = 0;
+    bool is_arg = false;
+};
+
+// Splits the format string into literal runs and placeholders. Called twice:
+// once to size the array, once to fill it.
+constexpr std::size_t parse_segments(std::string_view fmt, segment* out) {
+    std::size_t count = 0;
+    std::size_t literal = 0;
+    auto flush = [&](std::size_t end) {
+        if (end > literal) {
+            if (out) {
+                out[count] = {literal, end - literal, false};
+            }
+            ++count;
+        }
+    };
+    for (std::size_t i = 0; i < fmt.size(); ++i) {
+        if (fmt[i] == '{' && i + 1 < fmt.size() && fmt[i + 1] == '}') {
+            flush(i);
+            if (out) {
+                out[count] = {0, 0, true};
+            }
+            ++count;
+            literal = ++i + 1;
+        } else if ((fmt[i] == '{' || fmt[i] == '}') && i + 1 < fmt.size() && fmt[i + 1] == fmt[i]) {
+            flush(i + 1);
+            literal = ++i + 1;
+        } else if (fmt[i] == '{' || fmt[i] == '}') {
+            throw "unsupported format specification";
+        }
+    }
+    flush(fmt.size());
+    return count;
+}
+
+template <fixed_string Fmt>
+inline constexpr auto segments = [] {
+    std::array<segment, parse_segments(Fmt.view(), nullptr)> segs{};
+    parse_segments(Fmt.view(), segs.data());
+    return segs;
+}();
+
+template <fixed_string Fmt>
+consteval std::size_t literal_size() {
+    std::size_t size = 0;
+    for (const segment& s : segments<Fmt>) {
+        size += s.size;
+    }
+    return size;
+}
+
+template <fixed_string Fmt>
+consteval std::size_t arg_count() {
+    std::size_t count = 0;
+    for (const segment& s : segments<Fmt>) {
+        count += s.is_arg;
+    }
+    return count;
+}
+
+template <typename T>
+concept string_like = std::is_convertible_v<const T&, std::string_view>;
+
+// Upper bound on the characters one argument can produce.
+template <typename T>
+std::size_t max_width(const T& value) {
+    if constexpr (string_like<T>) {
+        return std::string_view(value).size();
+    } else if constexpr (std::floating_point<T>) {
+        return 32;
+    } else {
+        return std::numeric_limits<T>::digits10 + 3;
+    }
+}
+
+template <typename T>
+char* write_arg(char* out, const T& value) {
+    if constexpr (string_like<T>) {
+        std::string_view s(value);
+        std::memcpy(out, s.data(), s.size());
+        return out + s.size();
+    } else {
+        return std::to_chars(out, out + 32, value).ptr;
+    }
+}
+
+template <fixed_string Fmt, std::size_t Seg = 0, std::size_t Arg = 0, typename Tuple>
+char* write_segments(char* out, const Tuple& args) {
+    constexpr auto& segs = segments<Fmt>;
+    if constexpr (Seg == segs.size()) {
+        return out;
+    } else if constexpr (segs[Seg].is_arg) {
+        out = write_arg(out, std::get<Arg>(args));
+        return write_segments<Fmt, Seg + 1, Arg + 1>(out, args);
+    } else {
+        std::memcpy(out, Fmt.data + segs[Seg].begin, segs[Seg].size);
+        return write_segments<Fmt, Seg + 1, Arg>(out + segs[Seg].size, args);
+    }
+}
+
+struct format_result {
+    char* out;
+    std::size_t size;
+};
+
+// Like std::format_to_n: writes at most buffer.size() characters and reports
+// the full formatted size, so truncation can be detected.
+template <fixed_string Fmt, typename... Args>
+format_result format_into(std::span<char> buffer, const Args&... args) {
+    static_assert(sizeof...(Args) == arg_count<Fmt>(), "argument count does not match format string");
+    std::size_t bound = literal_size<Fmt>() + (max_width(args) + ... + 0);
+    if (bound <= buffer.size()) {
+        char* end = write_segments<Fmt>(buffer.data(), std::forward_as_tuple(args...));
+        return {end, static_cast<std::size_t>(end - buffer.data())};
+    }
+    std::string scratch(bound, '\0');
+    std::size_t size = write_segments<Fmt>(scratch.data(), std::forward_as_tuple(args...)) - scratch.data();
+    std::size_t copied = std::min(size, buffer.size());
+    std::memcpy(buffer.data(), scratch.data(), copied);
+    return {buffer.data() + copied, size};
+}
+
+// Fixed slots of formatted lines, written out in one call per drain.
+template <std::size_t SlotSize, std::size_t Slots>
+class output_ring {
+public:
+    template <fixed_string Fmt, typename... Args>
+    void emplace(const Args&... args) {
+        if (count_ == Slots) {
+            drain();
+        }
+        std::size_t slot = (head_ + count_) % Slots;
+        auto result = format_into<Fmt>(std::span<char>(slots_[slot]), args...);
+        sizes_[slot] = std::min(result.size, SlotSize);
+        ++count_;
+    }
+
+    void drain() {
+        for (; count_ > 0; --count_, head_ = (head_ + 1) % Slots) {
+            std::fwrite(slots_[head_].data(), 1, sizes_[head_], stdout);
+        }
+    }
+
+private:
+    std::array<std::array<char, SlotSize>, Slots> slots_{};
+    std::array<std::size_t, Slots> sizes_{};
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+};
+
+volatile std::size_t benchmark_sink;
+
+template <typename F>
+void run(const char* name, int iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t total = 0;
+    for (int i = 0; i < iterations; ++i) {
+        total += f(i);
+    }
+    benchmark_sink = total;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << name << ns / iterations << " ns/call" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 2'000'000;
+
+    std::array<char, 64> line;
+    auto result = format_into<"Hello, {}! You are {} years old.\n">(line, "Alice", 30);
+    std::fwrite(line.data(), 1, result.size, stdout);
+
+    output_ring<64, 8> ring;
+    for (int i = 0; i < 3; ++i) {
+        ring.emplace<"{{ring}} line {} of {}, ratio {}\n">(i + 1, 3, (i + 1) / 3.0);
+    }
+    ring.drain();
+    std::fflush(stdout);
+
+    std::array<char, 128> buffer;
+    const std::string name = "Alice";
+
+    std::cout << "integers: \"{} {} {} {}\"" << std::endl;
+    run("compiled format_into  ", iterations, [&](int i) {
+        return format_into<"{} {} {} {}">(buffer, i, i * 7, -i, 1'000'000 + i).size;
+    });
+    run("snprintf              ", iterations, [&](int i) {
+        return static_cast<std::size_t>(std::snprintf(buffer.data(), buffer.size(), "%d %d %d %d", i, i * 7, -i, 1'000'000 + i));
+    });
+    run("ostringstream         ", iterations, [&](int i) {
+        std::ostringstream os;
+        os << i << ' ' << i * 7 << ' ' << -i << ' ' << 1'000'000 + i;
+        return os.str().size();
+    });
+#if __has_include(<format>)
+    run("std::format           ", iterations, [&](int i) {
+        return std::format("{} {} {} {}", i, i * 7, -i, 1'000'000 + i).size();
+    });
+    run("std::format_to_n      ", iterations, [&](int i) {
+        return std::format_to_n(buffer.data(), buffer.size(), "{} {} {} {}", i, i * 7, -i, 1'000'000 + i).size;
+    });
+#endif
+
+    std::cout << "floats: \"x={} y={}\"" << std::endl;
+    run("compiled format_into  ", iterations, [&](int i) {
+        return format_into<"x={} y={}">(buffer, i * 0.1, i / 3.0).size;
+    });
+    run("snprintf %.17g        ", iterations, [&](int i) {
+        return static_cast<std::size_t>(std::snprintf(buffer.data(), buffer.size(), "x=%.17g y=%.17g", i * 0.1, i / 3.0));
+    });
+    run("ostringstream         ", iterations, [&](int i) {
+        std::ostringstream os;
+        os.precision(17);
+        os << "x=" << i * 0.1 << " y=" << i / 3.0;
+        return os.str().size();
+    });
+#if __has_include(<format>)
+    run("std::format           ", iterations, [&](int i) { return std::format("x={} y={}", i * 0.1, i / 3.0).size(); });
+    run("std::format_to_n      ", iterations, [&](int i) {
+        return std::format_to_n(buffer.data(), buffer.size(), "x={} y={}", i * 0.1, i / 3.0).size;
+    });
+#endif
+
+    std::cout << "strings: \"Hello, {}! You are {} years old.\"" << std::endl;
+    run("compiled format_into  ", iterations, [&](int i) {
+        return format_into<"Hello, {}! You are {} years old.">(buffer, name, i & 127).size;
+    });
+    run("snprintf              ", iterations, [&](int i) {
+        return static_cast<std::size_t>(
+            std::snprintf(buffer.data(), buffer.size(), "Hello, %s! You are %d years old.", name.c_str(), i & 127));
+    });
+    run("ostringstream         ", iterations, [&](int i) {
+        std::ostringstream os;
+        os << "Hello, " << name << "! You are " << (i & 127) << " years old.";
+        return os.str().size();
+    });
+#if __has_include(<format>)
+    run("std::format           ", iterations, [&](int i) {
+        return std::format("Hello, {}! You are {} years old.", name, i & 127).size();
+    });
+    run("std::format_to_n      ", iterations, [&](int i) {
+        return std::format_to_n(buffer.data(), buffer.size(), "Hello, {}! You are {} years old.", name, i & 127).size;
+    });
+#endif
+    return 0;
+}
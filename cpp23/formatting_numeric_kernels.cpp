@@ -0,0 +1,504 @@
+// Number-to-text kernels for bulk export: shortest round-trip doubles (Grisu3
+// with an exact fallback), digit-pair integer formatting and an 8-digits-at-a-
+// time SWAR (SIMD within a register) bulk writer for spans of integers.
+// Only the SWAR writer beats std::to_chars (about 2x here); the digit-pair
+// path is slightly slower, libstdc++ already using the same table. For the
+// CSV export of doubles, Grisu3 is 1.2-1.7x slower than libstdc++'s
+// Ryu-based std::to_chars; it stays as a portable reference implementation.
+// Build: g++ -std=c++23 -O2 formatting_numeric_kernels.cpp
+// Usage: ./a.out [count]   (default 10'000'000, try 100'000'000)
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#if __has_include(<format>)
+#include <format>
+#endif
+
+// "00" "01" ... "99": two output characters per division by 100.
+constexpr auto digit_pairs = [] {
+    std::array<char, 200> table{};
+    for (int i = 0; i < 100; ++i) {
+        table[2 * i] = static_cast<char>('0' + i / 10);
+        table[2 * i + 1] = static_cast<char>('0' + i % 10);
+    }
+    return table;
+}();
+
+int decimal_digits(std::uint64_t n) {
+    static constexpr std::uint64_t powers[] = {
+        0, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+        10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+        1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL};
+    int guess = (std::bit_width(n | 1) * 1233) >> 12;
+    return guess + (n >= powers[guess]);
+}
+
+char* write_unsigned(char* out, std::uint64_t n) {
+    int digits = decimal_digits(n);
+    char* end = out + digits;
+    char* p = end;
+    while (n >= 100) {
+        p -= 2;
+        std::memcpy(p, &digit_pairs[2 * (n % 100)], 2);
+        n /= 100;
+    }
+    if (n >= 10) {
+        std::memcpy(p - 2, &digit_pairs[2 * n], 2);
+    } else {
+        p[-1] = static_cast<char>('0' + n);
+    }
+    return end;
+}
+
+char* write_signed(char* out, std::int64_t n) {
+    if (n < 0) {
+        *out++ = '-';
+        return write_unsigned(out, 0 - static_cast<std::uint64_t>(n));
+    }
+    return write_unsigned(out, static_cast<std::uint64_t>(n));
+}
+
+// Eight ASCII digits of n < 10^8 computed in one 64-bit register: split into
+// two 4-digit halves, then into 2-digit and 1-digit lanes with multiply-shift
+// division. Byte i of the result is digit i (little endian).
+std::uint64_t eight_digits(std::uint32_t n) {
+    std::uint64_t merged = (n / 10000) | (static_cast<std::uint64_t>(n % 10000) << 32);
+    std::uint64_t top = ((merged * 10486) >> 20) & 0x0000007F0000007FULL;
+    std::uint64_t bottom = merged - 100 * top;
+    std::uint64_t hundreds = (bottom << 16) + top;
+    std::uint64_t tens = ((hundreds * 103) >> 10) & 0x000F000F000F000FULL;
+    tens += (hundreds - 10 * tens) << 8;
+    return tens + 0x3030303030303030ULL;
+}
+
+// Writes every value followed by sep. out needs 11 bytes per value plus 8 of
+// slack, because each value is stored as whole 8-byte words.
+static_assert(std::endian::native == std::endian::little, "write_bulk stores eight_digits() bytes in memory order");
+char* write_bulk(std::span<const std::uint32_t> values, char* out, char sep) {
+    for (std::uint32_t n : values) {
+        if (n >= 100000000) {
+            std::uint32_t high = n / 100000000;
+            n %= 100000000;
+            if (high >= 10) {
+                std::memcpy(out, &digit_pairs[2 * high], 2);
+                out += 2;
+            } else {
+                *out++ = static_cast<char>('0' + high);
+            }
+            std::uint64_t word = eight_digits(n);
+            std::memcpy(out, &word, 8);
+            out += 8;
+        } else {
+            int digits = decimal_digits(n);
+            std::uint64_t word = eight_digits(n) >> (8 * (8 - digits));
+            std::memcpy(out, &word, 8);
+            out += digits;
+        }
+        *out++ = sep;
+    }
+    return out;
+}
+
+namespace grisu {
+
+struct diy_fp {
+    std::uint64_t f;
+    int e;
+};
+
+inline diy_fp multiply(diy_fp a, diy_fp b) {
+    unsigned __int128 p = static_cast<unsigned __int128>(a.f) * b.f;
+    std::uint64_t high = static_cast<std::uint64_t>(p >> 64);
+    std::uint64_t low = static_cast<std::uint64_t>(p);
+    return {high + (low >> 63), a.e + b.e + 64};
+}
+
+inline diy_fp normalize(diy_fp x) {
+    int shift = std::countl_zero(x.f);
+    return {x.f << shift, x.e - shift};
+}
+
+struct cached_power {
+    std::uint64_t f;
+    int e;
+    int k;
+};
+
+// 10^k for k = -348, -340, ..., 340, rounded to 64 significant bits.
+constexpr cached_power powers[] = {
+    {0xfa8fd5a0081c0288, -1220, -348},
+    {0xbaaee17fa23ebf76, -1193, -340},
+    {0x8b16fb203055ac76, -1166, -332},
+    {0xcf42894a5dce35ea, -1140, -324},
+    {0x9a6bb0aa55653b2d, -1113, -316},
+    {0xe61acf033d1a45df, -1087, -308},
+    {0xab70fe17c79ac6ca, -1060, -300},
+    {0xff77b1fcbebcdc4f, -1034, -292},
+    {0xbe5691ef416bd60c, -1007, -284},
+    {0x8dd01fad907ffc3c, -980, -276},
+    {0xd3515c2831559a83, -954, -268},
+    {0x9d71ac8fada6c9b5, -927, -260},
+    {0xea9c227723ee8bcb, -901, -252},
+    {0xaecc49914078536d, -874, -244},
+    {0x823c12795db6ce57, -847, -236},
+    {0xc21094364dfb5637, -821, -228},
+    {0x9096ea6f3848984f, -794, -220},
+    {0xd77485cb25823ac7, -768, -212},
+    {0xa086cfcd97bf97f4, -741, -204},
+    {0xef340a98172aace5, -715, -196},
+    {0xb23867fb2a35b28e, -688, -188},
+    {0x84c8d4dfd2c63f3b, -661, -180},
+    {0xc5dd44271ad3cdba, -635, -172},
+    {0x936b9fcebb25c996, -608, -164},
+    {0xdbac6c247d62a584, -582, -156},
+    {0xa3ab66580d5fdaf6, -555, -148},
+    {0xf3e2f893dec3f126, -529, -140},
+    {0xb5b5ada8aaff80b8, -502, -132},
+    {0x87625f056c7c4a8b, -475, -124},
+    {0xc9bcff6034c13053, -449, -116},
+    {0x964e858c91ba2655, -422, -108},
+    {0xdff9772470297ebd, -396, -100},
+    {0xa6dfbd9fb8e5b88f, -369, -92},
+    {0xf8a95fcf88747d94, -343, -84},
+    {0xb94470938fa89bcf, -316, -76},
+    {0x8a08f0f8bf0f156b, -289, -68},
+    {0xcdb02555653131b6, -263, -60},
+    {0x993fe2c6d07b7fac, -236, -52},
+    {0xe45c10c42a2b3b06, -210, -44},
+    {0xaa242499697392d3, -183, -36},
+    {0xfd87b5f28300ca0e, -157, -28},
+    {0xbce5086492111aeb, -130, -20},
+    {0x8cbccc096f5088cc, -103, -12},
+    {0xd1b71758e219652c, -77, -4},
+    {0x9c40000000000000, -50, 4},
+    {0xe8d4a51000000000, -24, 12},
+    {0xad78ebc5ac620000, 3, 20},
+    {0x813f3978f8940984, 30, 28},
+    {0xc097ce7bc90715b3, 56, 36},
+    {0x8f7e32ce7bea5c70, 83, 44},
+    {0xd5d238a4abe98068, 109, 52},
+    {0x9f4f2726179a2245, 136, 60},
+    {0xed63a231d4c4fb27, 162, 68},
+    {0xb0de65388cc8ada8, 189, 76},
+    {0x83c7088e1aab65db, 216, 84},
+    {0xc45d1df942711d9a, 242, 92},
+    {0x924d692ca61be758, 269, 100},
+    {0xda01ee641a708dea, 295, 108},
+    {0xa26da3999aef774a, 322, 116},
+    {0xf209787bb47d6b85, 348, 124},
+    {0xb454e4a179dd1877, 375, 132},
+    {0x865b86925b9bc5c2, 402, 140},
+    {0xc83553c5c8965d3d, 428, 148},
+    {0x952ab45cfa97a0b3, 455, 156},
+    {0xde469fbd99a05fe3, 481, 164},
+    {0xa59bc234db398c25, 508, 172},
+    {0xf6c69a72a3989f5c, 534, 180},
+    {0xb7dcbf5354e9bece, 561, 188},
+    {0x88fcf317f22241e2, 588, 196},
+    {0xcc20ce9bd35c78a5, 614, 204},
+    {0x98165af37b2153df, 641, 212},
+    {0xe2a0b5dc971f303a, 667, 220},
+    {0xa8d9d1535ce3b396, 694, 228},
+    {0xfb9b7cd9a4a7443c, 720, 236},
+    {0xbb764c4ca7a44410, 747, 244},
+    {0x8bab8eefb6409c1a, 774, 252},
+    {0xd01fef10a657842c, 800, 260},
+    {0x9b10a4e5e9913129, 827, 268},
+    {0xe7109bfba19c0c9d, 853, 276},
+    {0xac2820d9623bf429, 880, 284},
+    {0x80444b5e7aa7cf85, 907, 292},
+    {0xbf21e44003acdd2d, 933, 300},
+    {0x8e679c2f5e44ff8f, 960, 308},
+    {0xd433179d9c8cb841, 986, 316},
+    {0x9e19db92b4e31ba9, 1013, 324},
+    {0xeb96bf6ebadf77d9, 1039, 332},
+    {0xaf87023b9bf0ee6b, 1066, 340},};
+
+// Picks the cached power c = 10^k that scales w into the binary exponent
+// window [-60, -32], so the integral part of the product fits in 32 bits.
+inline cached_power power_for(int e) {
+    constexpr int alpha = -60;
+    int min_e = alpha - (e + 64);
+    int index = static_cast<int>((static_cast<double>(min_e + 63) * 0.30102999566398114 + 347) / 8) + 1;
+    index = std::max(0, std::min<int>(index, std::size(powers) - 1));
+    while (index > 0 && powers[index - 1].e >= min_e) {
+        --index;
+    }
+    while (powers[index].e < min_e) {
+        ++index;
+    }
+    return powers[index];
+}
+
+// Moves the last digit towards w while the result stays inside the safe
+// interval; returns false when the digits cannot be proven shortest and closest.
+inline bool round_weed(char* buffer, int length, std::uint64_t distance_too_high_w, std::uint64_t unsafe_interval,
+                       std::uint64_t rest, std::uint64_t ten_kappa, std::uint64_t unit) {
+    std::uint64_t small_distance = distance_too_high_w - unit;
+    std::uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        --buffer[length - 1];
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+inline bool digit_gen(diy_fp low, diy_fp w, diy_fp high, char* buffer, int& length, int& kappa) {
+    std::uint64_t unit = 1;
+    diy_fp too_low{low.f - unit, low.e};
+    diy_fp too_high{high.f + unit, high.e};
+    std::uint64_t unsafe_interval = too_high.f - too_low.f;
+    int shift = -w.e;
+    std::uint64_t one = std::uint64_t{1} << shift;
+    std::uint32_t integrals = static_cast<std::uint32_t>(too_high.f >> shift);
+    std::uint64_t fractionals = too_high.f & (one - 1);
+
+    kappa = decimal_digits(integrals);
+    std::uint32_t divisor = 1;
+    for (int i = 1; i < kappa; ++i) {
+        divisor *= 10;
+    }
+    length = 0;
+    while (kappa > 0) {
+        buffer[length++] = static_cast<char>('0' + integrals / divisor);
+        integrals %= divisor;
+        --kappa;
+        std::uint64_t rest = (static_cast<std::uint64_t>(integrals) << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            return round_weed(buffer, length, too_high.f - w.f, unsafe_interval, rest,
+                              static_cast<std::uint64_t>(divisor) << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buffer[length++] = static_cast<char>('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        --kappa;
+        if (fractionals < unsafe_interval) {
+            return round_weed(buffer, length, (too_high.f - w.f) * unit, unsafe_interval, fractionals, one, unit);
+        }
+    }
+}
+
+// Shortest digits of a positive finite v, with v = digits * 10^exponent.
+// Fails for roughly 0.5% of inputs, which the caller hands to std::to_chars.
+inline bool shortest(double v, char* buffer, int& length, int& exponent) {
+    std::uint64_t bits = std::bit_cast<std::uint64_t>(v);
+    std::uint64_t fraction = bits & ((std::uint64_t{1} << 52) - 1);
+    int biased = static_cast<int>(bits >> 52);
+    diy_fp value = biased == 0 ? diy_fp{fraction, -1074} : diy_fp{fraction | (std::uint64_t{1} << 52), biased - 1075};
+
+    diy_fp plus = normalize({(value.f << 1) + 1, value.e - 1});
+    bool closer_below = fraction == 0 && biased > 1;
+    diy_fp minus = closer_below ? diy_fp{(value.f << 2) - 1, value.e - 2} : diy_fp{(value.f << 1) - 1, value.e - 1};
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    diy_fp w = normalize(value);
+
+    cached_power c = power_for(w.e);
+    diy_fp ten_mk{c.f, c.e};
+    int kappa = 0;
+    if (!digit_gen(multiply(minus, ten_mk), multiply(w, ten_mk), multiply(plus, ten_mk), buffer, length, kappa)) {
+        return false;
+    }
+    exponent = kappa - c.k;
+    return true;
+}
+
+} // namespace grisu
+
+// Same text as std::to_chars(first, last, v): the shorter of fixed and
+// scientific notation with the shortest round-trip digits, fixed on a tie.
+char* write_double(char* out, double v) {
+    if (!std::isfinite(v)) {
+        return std::to_chars(out, out + 32, v).ptr;
+    }
+    if (std::signbit(v)) {
+        *out++ = '-';
+        v = -v;
+    }
+    if (v == 0) {
+        *out++ = '0';
+        return out;
+    }
+    char digits[24];
+    int n = 0, exponent = 0;
+    if (!grisu::shortest(v, digits, n, exponent)) {
+        auto fallback = std::to_chars(digits, digits + sizeof digits, v, std::chars_format::scientific);
+        // "d.ddde+XX" -> digits and exponent
+        const char* e = std::find(digits, fallback.ptr, 'e');
+        int x = 0;
+        std::from_chars(e + (e[1] == '+' ? 2 : 1), fallback.ptr, x);
+        n = 0;
+        for (const char* p = digits; p != e; ++p) {
+            if (*p != '.') {
+                digits[n++] = *p;
+            }
+        }
+        exponent = x - (n - 1);
+    }
+
+    int point = n + exponent;  // value = 0.digits * 10^point
+    int scientific_exponent = point - 1;
+    int abs_exponent = scientific_exponent < 0 ? -scientific_exponent : scientific_exponent;
+    int scientific_size = n + (n > 1) + 2 + (abs_exponent >= 100 ? 3 : 2);
+    int fixed_size = point <= 0 ? 2 - point + n : point < n ? n + 1 : point;
+
+    if (fixed_size <= scientific_size) {
+        if (point <= 0) {
+            *out++ = '0';
+            *out++ = '.';
+            std::memset(out, '0', -point);
+            out += -point;
+            std::memcpy(out, digits, n);
+            return out + n;
+        }
+        if (point < n) {
+            std::memcpy(out, digits, point);
+            out[point] = '.';
+            std::memcpy(out + point + 1, digits + point, n - point);
+            return out + n + 1;
+        }
+        // Fixed notation of an integral value prints its exact digits, not
+        // the shortest digits padded with zeros.
+        if (v < 18446744073709551616.0) {
+            return write_unsigned(out, static_cast<std::uint64_t>(v));
+        }
+        return std::to_chars(out, out + 32, v).ptr;
+    }
+    *out++ = digits[0];
+    if (n > 1) {
+        *out++ = '.';
+        std::memcpy(out, digits + 1, n - 1);
+        out += n - 1;
+    }
+    *out++ = 'e';
+    *out++ = scientific_exponent < 0 ? '-' : '+';
+    if (abs_exponent >= 100) {
+        *out++ = static_cast<char>('0' + abs_exponent / 100);
+        abs_exponent %= 100;
+    }
+    std::memcpy(out, &digit_pairs[2 * abs_exponent], 2);
+    return out + 2;
+}
+
+// Formats rows of a CSV export through a 1 MiB buffer, as a file writer would.
+template <typename WriteValue>
+double csv_seconds(std::span<const double> values, WriteValue write_value, std::size_t& bytes) {
+    std::vector<char> buffer(1 << 20);
+    auto start = std::chrono::steady_clock::now();
+    char* out = buffer.data();
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (buffer.data() + buffer.size() - out < 64) {
+            bytes += out - buffer.data();
+            out = buffer.data();
+        }
+        out = write_value(out, values[i]);
+        *out++ = (i % 8 == 7) ? '\n' : ',';
+    }
+    bytes += out - buffer.data();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::stoull(argv[1]) : 10'000'000;
+    std::mt19937_64 gen(42);
+
+    // Compare with the library on random bit patterns and on "human" values.
+    std::size_t mismatches = 0;
+    constexpr int checks = 1'000'000;
+    for (int i = 0; i < checks; ++i) {
+        double v = i % 2 ? std::bit_cast<double>(gen()) : static_cast<double>(gen() % 100000) / 100;
+        char ours[40], theirs[40];
+        char* end = write_double(ours, v);
+        char* expected = std::to_chars(theirs, theirs + sizeof theirs, v).ptr;
+        if (std::string_view(ours, end) != std::string_view(theirs, expected)) {
+            if (++mismatches <= 5) {
+                std::cout << "mismatch: " << std::string_view(ours, end) << " vs " << std::string_view(theirs, expected) << std::endl;
+            }
+        }
+    }
+    std::cout << "checked " << checks << " doubles against std::to_chars, mismatches: " << mismatches << std::endl;
+
+    std::vector<double> values(count);
+    std::uniform_real_distribution<double> dis(-1e6, 1e6);
+    for (double& v : values) {
+        v = dis(gen);
+    }
+
+    std::cout << "CSV export of " << count << " doubles" << std::endl;
+    auto report = [&](const char* name, auto write_value) {
+        std::size_t bytes = 0;
+        double s = csv_seconds(values, write_value, bytes);
+        std::cout << "  " << name << s * 1e9 / count << " ns/value, " << bytes / s * 1e-6 << " MB/s" << std::endl;
+    };
+    report("grisu3 write_double ", [](char* out, double v) { return write_double(out, v); });
+    report("std::to_chars       ", [](char* out, double v) { return std::to_chars(out, out + 32, v).ptr; });
+    report("snprintf %.17g      ", [](char* out, double v) { return out + std::snprintf(out, 32, "%.17g", v); });
+#if __has_include(<format>)
+    report("std::format_to      ", [](char* out, double v) { return std::format_to(out, "{}", v); });
+#endif
+
+    std::vector<std::uint32_t> ints(count);
+    for (std::uint32_t& n : ints) {
+        n = static_cast<std::uint32_t>(gen() >> (32 + gen() % 32));
+    }
+    std::vector<char> text(count * 11 + 8);
+    std::cout << "formatting " << count << " uint32 values" << std::endl;
+    auto time_ints = [&](const char* name, auto body) {
+        auto start = std::chrono::steady_clock::now();
+        char* end = body(text.data());
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << name << s * 1e9 / count << " ns/value (" << end - text.data() << " bytes)" << std::endl;
+    };
+    time_ints("SWAR write_bulk     ", [&](char* out) { return write_bulk(ints, out, ','); });
+    time_ints("digit pairs         ", [&](char* out) {
+        for (std::uint32_t n : ints) {
+            out = write_unsigned(out, n);
+            *out++ = ',';
+        }
+        return out;
+    });
+    time_ints("std::to_chars       ", [&](char* out) {
+        for (std::uint32_t n : ints) {
+            out = std::to_chars(out, out + 10, n).ptr;
+            *out++ = ',';
+        }
+        return out;
+    });
+    time_ints("snprintf            ", [&](char* out) {
+        for (std::uint32_t n : ints) {
+            out += std::snprintf(out, 12, "%u", n);
+            *out++ = ',';
+        }
+        return out;
+    });
+
+    char line[64];
+    char* end = write_signed(line, -1234567890123LL);
+    *end++ = ' ';
+    end = write_double(end, 0.1 + 0.2);
+    std::cout << std::string_view(line, end) << std::endl;
+    return 0;
+}
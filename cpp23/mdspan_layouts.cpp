@@ -0,0 +1,512 @@
+// Custom mdspan layout and accessor policies with cache-aware kernels.
+// Layouts: tiled (blocked), Morton (Z-order), padded row stride.
+// Accessors: aligned, restrict, streaming (non-temporal stores).
+// Build: g++ -std=c++23 -O3 -march=native mdspan_layouts.cpp
+// Usage: ./a.out [max_gemm_n] [max_n]   (defaults 512 and 4096)
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mdspan>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using extents2d = std::dextents<std::size_t, 2>;
+
+// Tile x Tile blocks stored contiguously, blocks in row-major order.
+// A blocked kernel whose block size matches Tile touches one contiguous
+// Tile*Tile chunk per block instead of Tile rows spread over the matrix.
+template <std::size_t Tile>
+struct layout_tiled {
+    template <class Extents>
+    class mapping {
+    public:
+        static_assert(Extents::rank() == 2, "layout_tiled is for matrices");
+        using extents_type = Extents;
+        using index_type = typename Extents::index_type;
+        using size_type = typename Extents::size_type;
+        using rank_type = typename Extents::rank_type;
+        using layout_type = layout_tiled;
+
+        constexpr mapping() noexcept = default;
+        constexpr mapping(const extents_type& e) noexcept
+            : extents_(e), tiles_per_row_((e.extent(1) + Tile - 1) / Tile) {}
+
+        constexpr const extents_type& extents() const noexcept { return extents_; }
+
+        constexpr index_type required_span_size() const noexcept {
+            return (extents_.extent(0) + Tile - 1) / Tile * tiles_per_row_ * Tile * Tile;
+        }
+
+        constexpr index_type operator()(index_type i, index_type j) const noexcept {
+            index_type tile = (i / Tile) * tiles_per_row_ + j / Tile;
+            return tile * Tile * Tile + (i % Tile) * Tile + j % Tile;
+        }
+
+        static constexpr bool is_always_unique() noexcept { return true; }
+        static constexpr bool is_always_exhaustive() noexcept { return false; }
+        static constexpr bool is_always_strided() noexcept { return false; }
+        static constexpr bool is_unique() noexcept { return true; }
+        constexpr bool is_exhaustive() const noexcept {
+            return extents_.extent(0) % Tile == 0 && extents_.extent(1) % Tile == 0;
+        }
+        static constexpr bool is_strided() noexcept { return false; }
+
+        friend constexpr bool operator==(const mapping& a, const mapping& b) noexcept {
+            return a.extents_ == b.extents_;
+        }
+
+    private:
+        extents_type extents_{};
+        index_type tiles_per_row_ = 0;
+    };
+};
+
+// Z-order: the bits of i and j are interleaved, so neighbours in either
+// direction are close in memory at every scale. Exhaustive for square
+// power-of-two matrices.
+struct layout_morton {
+    template <class Extents>
+    class mapping {
+    public:
+        static_assert(Extents::rank() == 2, "layout_morton is for matrices");
+        using extents_type = Extents;
+        using index_type = typename Extents::index_type;
+        using size_type = typename Extents::size_type;
+        using rank_type = typename Extents::rank_type;
+        using layout_type = layout_morton;
+
+        constexpr mapping() noexcept = default;
+        constexpr mapping(const extents_type& e) noexcept : extents_(e) {}
+
+        constexpr const extents_type& extents() const noexcept { return extents_; }
+
+        constexpr index_type required_span_size() const noexcept {
+            if (extents_.extent(0) == 0 || extents_.extent(1) == 0) {
+                return 0;
+            }
+            return (*this)(extents_.extent(0) - 1, extents_.extent(1) - 1) + 1;
+        }
+
+        constexpr index_type operator()(index_type i, index_type j) const noexcept {
+            return static_cast<index_type>((spread(i) << 1) | spread(j));
+        }
+
+        static constexpr bool is_always_unique() noexcept { return true; }
+        static constexpr bool is_always_exhaustive() noexcept { return false; }
+        static constexpr bool is_always_strided() noexcept { return false; }
+        static constexpr bool is_unique() noexcept { return true; }
+        constexpr bool is_exhaustive() const noexcept {
+            return extents_.extent(0) == extents_.extent(1) && std::has_single_bit(extents_.extent(0));
+        }
+        static constexpr bool is_strided() noexcept { return false; }
+
+        friend constexpr bool operator==(const mapping& a, const mapping& b) noexcept {
+            return a.extents_ == b.extents_;
+        }
+
+    private:
+        // Moves bit k of a 32-bit value to bit 2k.
+        static constexpr std::uint64_t spread(std::uint64_t x) noexcept {
+            x &= 0xffffffff;
+            x = (x | (x << 16)) & 0x0000ffff0000ffff;
+            x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+            x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+            x = (x | (x << 2)) & 0x3333333333333333;
+            x = (x | (x << 1)) & 0x5555555555555555;
+            return x;
+        }
+
+        extents_type extents_{};
+    };
+};
+
+// Row-major with the row stride rounded up to whole cache lines, plus one
+// extra line when the stride is a multiple of 4 KiB. Power-of-two widths
+// otherwise map every row of a column to the same L1 set.
+template <std::size_t LineElems>
+struct layout_padded {
+    template <class Extents>
+    class mapping {
+    public:
+        static_assert(Extents::rank() == 2, "layout_padded is for matrices");
+        using extents_type = Extents;
+        using index_type = typename Extents::index_type;
+        using size_type = typename Extents::size_type;
+        using rank_type = typename Extents::rank_type;
+        using layout_type = layout_padded;
+
+        constexpr mapping() noexcept = default;
+        constexpr mapping(const extents_type& e) noexcept : extents_(e), stride_(padded_stride(e.extent(1))) {}
+
+        constexpr const extents_type& extents() const noexcept { return extents_; }
+        constexpr index_type required_span_size() const noexcept { return extents_.extent(0) * stride_; }
+        constexpr index_type operator()(index_type i, index_type j) const noexcept { return i * stride_ + j; }
+        constexpr index_type stride(rank_type r) const noexcept { return r == 0 ? stride_ : 1; }
+
+        static constexpr bool is_always_unique() noexcept { return true; }
+        static constexpr bool is_always_exhaustive() noexcept { return false; }
+        static constexpr bool is_always_strided() noexcept { return true; }
+        static constexpr bool is_unique() noexcept { return true; }
+        constexpr bool is_exhaustive() const noexcept { return stride_ == extents_.extent(1); }
+        static constexpr bool is_strided() noexcept { return true; }
+
+        friend constexpr bool operator==(const mapping& a, const mapping& b) noexcept {
+            return a.extents_ == b.extents_;
+        }
+
+    private:
+        static constexpr index_type padded_stride(index_type cols) noexcept {
+            index_type stride = (cols + LineElems - 1) / LineElems * LineElems;
+            return stride % (64 * LineElems) == 0 ? stride + LineElems : stride;
+        }
+
+        extents_type extents_{};
+        index_type stride_ = 0;
+    };
+};
+
+// Promises the compiler that the data handle is Align-byte aligned.
+template <class T, std::size_t Align = 64>
+struct aligned_accessor {
+    using offset_policy = std::default_accessor<T>;
+    using element_type = T;
+    using reference = T&;
+    using data_handle_type = T*;
+
+    constexpr reference access(data_handle_type p, std::size_t i) const noexcept {
+        return std::assume_aligned<Align>(p)[i];
+    }
+    constexpr typename offset_policy::data_handle_type offset(data_handle_type p, std::size_t i) const noexcept {
+        return p + i;
+    }
+};
+
+// Marks the data handle as not aliasing any other mdspan in the kernel.
+template <class T>
+struct restrict_accessor {
+    using offset_policy = std::default_accessor<T>;
+    using element_type = T;
+    using reference = T&;
+    using data_handle_type = T* __restrict;
+
+    constexpr reference access(data_handle_type p, std::size_t i) const noexcept { return p[i]; }
+    constexpr typename offset_policy::data_handle_type offset(data_handle_type p, std::size_t i) const noexcept {
+        return p + i;
+    }
+};
+
+// Writes bypass the cache, so a large output does not evict the input.
+// Call stream_fence() after the kernel before other threads read the data.
+template <class T>
+struct streaming_accessor {
+    struct reference {
+        T* p;
+
+        reference& operator=(T value) noexcept {
+#if defined(__x86_64__)
+            if constexpr (sizeof(T) == 8 && std::is_trivially_copyable_v<T>) {
+                _mm_stream_si64(reinterpret_cast<long long*>(p), std::bit_cast<long long>(value));
+                return *this;
+            } else if constexpr (sizeof(T) == 4 && std::is_trivially_copyable_v<T>) {
+                _mm_stream_si32(reinterpret_cast<int*>(p), std::bit_cast<int>(value));
+                return *this;
+            }
+#endif
+            *p = value;
+            return *this;
+        }
+        operator T() const noexcept { return *p; }
+    };
+
+    using offset_policy = streaming_accessor;
+    using element_type = T;
+    using data_handle_type = T*;
+
+    constexpr reference access(data_handle_type p, std::size_t i) const noexcept { return reference{p + i}; }
+    constexpr data_handle_type offset(data_handle_type p, std::size_t i) const noexcept { return p + i; }
+};
+
+inline void stream_fence() {
+#if defined(__x86_64__)
+    _mm_sfence();
+#endif
+}
+
+// Kernels are written against any rank-2 mdspan; the layout and accessor
+// decide the memory traffic.
+
+template <class A, class B, class C>
+void gemm_naive(A a, B b, C c) {
+    for (std::size_t i = 0; i < c.extent(0); ++i) {
+        for (std::size_t j = 0; j < c.extent(1); ++j) {
+            double sum = 0;
+            for (std::size_t k = 0; k < a.extent(1); ++k) {
+                sum += a[i, k] * b[k, j];
+            }
+            c[i, j] = sum;
+        }
+    }
+}
+
+template <std::size_t Block, class A, class B, class C>
+void gemm_blocked(A a, B b, C c) {
+    const std::size_t n = c.extent(0), m = c.extent(1), p = a.extent(1);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < m; ++j) {
+            c[i, j] = 0;
+        }
+    }
+    for (std::size_t ii = 0; ii < n; ii += Block) {
+        for (std::size_t kk = 0; kk < p; kk += Block) {
+            for (std::size_t jj = 0; jj < m; jj += Block) {
+                for (std::size_t i = ii; i < std::min(ii + Block, n); ++i) {
+                    for (std::size_t k = kk; k < std::min(kk + Block, p); ++k) {
+                        double aik = a[i, k];
+                        for (std::size_t j = jj; j < std::min(jj + Block, m); ++j) {
+                            c[i, j] += aik * b[k, j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Each tile of a layout_tiled matrix is a contiguous row-major Tile x Tile
+// block, so it can be viewed as a layout_right mdspan with static extents and
+// the inner loops see unit stride and compile-time trip counts.
+template <std::size_t Tile>
+using tile_span = std::mdspan<double, std::extents<std::size_t, Tile, Tile>>;
+
+// The block arithmetic below is only valid for this layout; any other one
+// would compile and compute garbage.
+template <class M, std::size_t Tile>
+constexpr bool is_tiled = std::is_same_v<typename M::layout_type, layout_tiled<Tile>>;
+
+template <std::size_t Tile, class M>
+    requires is_tiled<M, Tile>
+tile_span<Tile> tile(M m, std::size_t ti, std::size_t tj) {
+    return tile_span<Tile>(&m[ti * Tile, tj * Tile]);
+}
+
+// Requires square matrices whose extent is a multiple of Tile.
+template <std::size_t Tile, class A, class B, class C>
+    requires is_tiled<A, Tile> && is_tiled<B, Tile> && is_tiled<C, Tile>
+void gemm_tiled(A a, B b, C c) {
+    const std::size_t tiles = c.extent(0) / Tile;
+    for (std::size_t ti = 0; ti < tiles; ++ti) {
+        for (std::size_t tj = 0; tj < tiles; ++tj) {
+            auto ct = tile<Tile>(c, ti, tj);
+            for (std::size_t i = 0; i < Tile; ++i) {
+                for (std::size_t j = 0; j < Tile; ++j) {
+                    ct[i, j] = 0;
+                }
+            }
+            for (std::size_t tk = 0; tk < tiles; ++tk) {
+                auto at = tile<Tile>(a, ti, tk);
+                auto bt = tile<Tile>(b, tk, tj);
+                for (std::size_t i = 0; i < Tile; ++i) {
+                    for (std::size_t k = 0; k < Tile; ++k) {
+                        double aik = at[i, k];
+                        for (std::size_t j = 0; j < Tile; ++j) {
+                            ct[i, j] += aik * bt[k, j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <class In, class Out>
+void transpose_naive(In in, Out out) {
+    for (std::size_t i = 0; i < in.extent(0); ++i) {
+        for (std::size_t j = 0; j < in.extent(1); ++j) {
+            out[j, i] = in[i, j];
+        }
+    }
+}
+
+template <std::size_t Block, class In, class Out>
+void transpose_blocked(In in, Out out) {
+    const std::size_t n = in.extent(0), m = in.extent(1);
+    for (std::size_t ii = 0; ii < n; ii += Block) {
+        for (std::size_t jj = 0; jj < m; jj += Block) {
+            for (std::size_t j = jj; j < std::min(jj + Block, m); ++j) {
+                for (std::size_t i = ii; i < std::min(ii + Block, n); ++i) {
+                    out[j, i] = in[i, j];
+                }
+            }
+        }
+    }
+}
+
+// One Jacobi sweep of the 5-point Laplace stencil over the interior.
+template <class In, class Out>
+void stencil(In in, Out out) {
+    for (std::size_t i = 1; i + 1 < in.extent(0); ++i) {
+        for (std::size_t j = 1; j + 1 < in.extent(1); ++j) {
+            out[i, j] = 0.25 * (in[i - 1, j] + in[i + 1, j] + in[i, j - 1] + in[i, j + 1]);
+        }
+    }
+}
+
+using buffer = std::unique_ptr<double[], decltype(&std::free)>;
+
+buffer make_buffer(std::size_t count) {
+    std::size_t bytes = (count * sizeof(double) + 63) / 64 * 64;
+    return buffer(static_cast<double*>(std::aligned_alloc(64, bytes)), &std::free);
+}
+
+template <class Layout>
+auto make_matrix(buffer& storage, std::size_t n) {
+    typename Layout::template mapping<extents2d> map(extents2d(n, n));
+    storage = make_buffer(map.required_span_size());
+    std::mdspan<double, extents2d, Layout> m(storage.get(), map);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            m[i, j] = static_cast<double>((i * 7 + j * 3) % 11) - 5.0;
+        }
+    }
+    return m;
+}
+
+template <class F>
+double seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <class M>
+double checksum(M m) {
+    double sum = 0;
+    for (std::size_t i = 0; i < m.extent(0); ++i) {
+        for (std::size_t j = 0; j < m.extent(1); ++j) {
+            sum += m[i, j] * static_cast<double>(i + 1);
+        }
+    }
+    return sum;
+}
+
+void benchmark_gemm(std::size_t n) {
+    buffer a_buf(nullptr, &std::free), b_buf(nullptr, &std::free), c_buf(nullptr, &std::free);
+    auto a = make_matrix<std::layout_right>(a_buf, n);
+    auto b = make_matrix<std::layout_right>(b_buf, n);
+    auto c = make_matrix<std::layout_right>(c_buf, n);
+    double flops = 2.0 * n * n * n;
+
+    double t = seconds([&] { gemm_naive(a, b, c); });
+    double expected = checksum(c);
+    std::cout << "gemm " << n << "x" << n << std::endl;
+    std::cout << "  naive layout_right       " << flops / t * 1e-9 << " GFLOP/s" << std::endl;
+
+    using aligned = aligned_accessor<double>;
+    std::mdspan<double, extents2d, std::layout_right, aligned> aa(a.data_handle(), a.mapping(), aligned{});
+    std::mdspan<double, extents2d, std::layout_right, aligned> ab(b.data_handle(), b.mapping(), aligned{});
+    std::mdspan<double, extents2d, std::layout_right, aligned> ac(c.data_handle(), c.mapping(), aligned{});
+    t = seconds([&] { gemm_blocked<64>(aa, ab, ac); });
+    std::cout << "  blocked layout_right     " << flops / t * 1e-9 << " GFLOP/s"
+              << (checksum(c) == expected ? "" : " (mismatch)") << std::endl;
+
+    buffer ta_buf(nullptr, &std::free), tb_buf(nullptr, &std::free), tc_buf(nullptr, &std::free);
+    auto ta = make_matrix<layout_tiled<64>>(ta_buf, n);
+    auto tb = make_matrix<layout_tiled<64>>(tb_buf, n);
+    auto tc = make_matrix<layout_tiled<64>>(tc_buf, n);
+    t = seconds([&] { gemm_tiled<64>(ta, tb, tc); });
+    std::cout << "  tiled layout_tiled<64>   " << flops / t * 1e-9 << " GFLOP/s"
+              << (checksum(tc) == expected ? "" : " (mismatch)") << std::endl;
+}
+
+void benchmark_transpose(std::size_t n) {
+    buffer in_buf(nullptr, &std::free), out_buf(nullptr, &std::free);
+    auto in = make_matrix<std::layout_right>(in_buf, n);
+    auto out = make_matrix<std::layout_right>(out_buf, n);
+    double bytes = 2.0 * n * n * sizeof(double);
+
+    std::cout << "transpose " << n << "x" << n << " (" << bytes / 2 / (1 << 20) << " MiB per matrix)" << std::endl;
+    double t = seconds([&] { transpose_naive(in, out); });
+    std::cout << "  naive layout_right       " << bytes / t * 1e-9 << " GB/s" << std::endl;
+    t = seconds([&] { transpose_blocked<32>(in, out); });
+    std::cout << "  blocked                  " << bytes / t * 1e-9 << " GB/s" << std::endl;
+
+    using streaming = streaming_accessor<double>;
+    std::mdspan<double, extents2d, std::layout_right, streaming> sout(out.data_handle(), out.mapping(), streaming{});
+    t = seconds([&] {
+        transpose_blocked<32>(in, sout);
+        stream_fence();
+    });
+    std::cout << "  blocked, streaming store " << bytes / t * 1e-9 << " GB/s" << std::endl;
+
+    if (std::has_single_bit(n)) {
+        buffer z_buf(nullptr, &std::free);
+        auto z = make_matrix<layout_morton>(z_buf, n);
+        t = seconds([&] { transpose_naive(z, out); });
+        std::cout << "  naive from layout_morton " << bytes / t * 1e-9 << " GB/s" << std::endl;
+    }
+}
+
+void benchmark_stencil(std::size_t n) {
+    constexpr int sweeps = 4;
+    double flops = 4.0 * (n - 2) * (n - 2) * sweeps;
+    std::cout << "stencil " << n << "x" << n << ", " << sweeps << " sweeps" << std::endl;
+
+    buffer a_buf(nullptr, &std::free), b_buf(nullptr, &std::free);
+    auto a = make_matrix<std::layout_right>(a_buf, n);
+    auto b = make_matrix<std::layout_right>(b_buf, n);
+    double t = seconds([&] {
+        for (int s = 0; s < sweeps; ++s) {
+            stencil(a, b);
+            std::swap(a, b);
+        }
+    });
+    std::cout << "  layout_right             " << flops / t * 1e-9 << " GFLOP/s" << std::endl;
+
+    using restricted = restrict_accessor<double>;
+    buffer pa_buf(nullptr, &std::free), pb_buf(nullptr, &std::free);
+    auto pa = make_matrix<layout_padded<8>>(pa_buf, n);
+    auto pb = make_matrix<layout_padded<8>>(pb_buf, n);
+    std::mdspan<double, extents2d, layout_padded<8>, restricted> ra(pa.data_handle(), pa.mapping(), restricted{});
+    std::mdspan<double, extents2d, layout_padded<8>, restricted> rb(pb.data_handle(), pb.mapping(), restricted{});
+    t = seconds([&] {
+        for (int s = 0; s < sweeps; ++s) {
+            stencil(ra, rb);
+            std::swap(ra, rb);
+        }
+    });
+    std::cout << "  layout_padded<8>         " << flops / t * 1e-9 << " GFLOP/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t max_gemm_n = argc > 1 ? std::stoull(argv[1]) : 512;
+    std::size_t max_n = argc > 2 ? std::stoull(argv[2]) : 4096;
+
+    std::vector<int> data = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    std::mdspan<int, extents2d, layout_morton> z(data.data(), extents2d(4, 4));
+    std::cout << "4x4 matrix in Morton order:" << std::endl;
+    for (std::size_t i = 0; i < z.extent(0); ++i) {
+        for (std::size_t j = 0; j < z.extent(1); ++j) {
+            std::cout << z[i, j] << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    for (std::size_t n = 128; n <= max_gemm_n; n *= 2) {
+        benchmark_gemm(n);
+    }
+    for (std::size_t n = 1024; n <= max_n; n *= 2) {
+        benchmark_transpose(n);
+        benchmark_stencil(n);
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+// Cheap stack sampling for hot paths. Capture only records raw frames into a
+// per-thread buffer and counts them in a lock-free table keyed by a hash of
+// the frames; symbolization happens later on a background thread, once per
+// distinct stack.
+// Build: g++ -std=c++23 -O2 stacktrace_sampling.cpp -lstdc++exp
+// Usage: ./a.out [samples_per_thread]   (default 1'000'000)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <stacktrace>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Bump allocator for one capture. The frames only live until they are hashed
+// and copied into the table, so the arena is simply rewound before the next
+// capture and nothing is ever freed.
+class capture_arena {
+public:
+    void* allocate(std::size_t bytes, std::size_t align) {
+        std::size_t start = (used_ + align - 1) & ~(align - 1);
+        if (start + bytes > sizeof(buffer_)) {
+            throw std::bad_alloc();
+        }
+        used_ = start + bytes;
+        return buffer_ + start;
+    }
+    void rewind() noexcept { used_ = 0; }
+
+private:
+    alignas(std::max_align_t) std::byte buffer_[16 * 1024];
+    std::size_t used_ = 0;
+};
+
+template <typename T>
+struct capture_allocator {
+    using value_type = T;
+
+    capture_arena* arena;
+
+    explicit capture_allocator(capture_arena* a) noexcept : arena(a) {}
+    template <typename U>
+    capture_allocator(const capture_allocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, std::size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(const capture_allocator<U>& other) const noexcept { return arena == other.arena; }
+};
+
+using raw_stacktrace = std::basic_stacktrace<capture_allocator<std::stacktrace_entry>>;
+
+// Open-addressed table of distinct stacks. A slot is claimed with one CAS on
+// its hash; the claiming thread copies the frames and then publishes them with
+// the ready flag. Two stacks with the same 64-bit hash are counted together.
+class stack_table {
+public:
+    static constexpr std::size_t capacity = 4096;
+    static constexpr std::size_t max_depth = 32;
+
+    struct slot {
+        std::atomic<std::uint64_t> hash{0};
+        std::atomic<std::uint64_t> hits{0};
+        std::atomic<bool> ready{false};
+        std::size_t depth = 0;
+        std::array<std::stacktrace_entry, max_depth> frames{};
+    };
+
+    // Returns false only when the table is full.
+    bool record(const raw_stacktrace& trace, std::uint64_t hash) noexcept {
+        for (std::size_t probe = 0; probe < capacity; ++probe) {
+            slot& s = slots_[(hash + probe) & (capacity - 1)];
+            std::uint64_t seen = s.hash.load(std::memory_order_acquire);
+            if (seen == 0 && s.hash.compare_exchange_strong(seen, hash, std::memory_order_acq_rel)) {
+                s.depth = std::min(trace.size(), max_depth);
+                std::copy_n(trace.begin(), s.depth, s.frames.begin());
+                s.ready.store(true, std::memory_order_release);
+                seen = hash;
+            }
+            if (seen == hash) {
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    slot& operator[](std::size_t i) { return slots_[i]; }
+
+private:
+    std::array<slot, capacity> slots_;
+};
+
+class stack_sampler {
+public:
+    explicit stack_sampler(std::chrono::milliseconds symbolize_every)
+        : symbols_(stack_table::capacity),
+          symbolizer_([this, symbolize_every](std::stop_token st) {
+              while (!st.stop_requested()) {
+                  symbolize_pending();
+                  std::this_thread::sleep_for(symbolize_every);
+              }
+          }) {}
+
+    // Hot path: no locks, no heap allocation, no symbol lookup.
+    void sample() noexcept {
+        thread_local capture_arena arena;
+        arena.rewind();
+        auto trace = raw_stacktrace::current(1, stack_table::max_depth, capture_allocator<std::stacktrace_entry>(&arena));
+        if (trace.empty()) {
+            return;
+        }
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const std::stacktrace_entry& frame : trace) {
+            hash = (hash ^ frame.native_handle()) * 0x100000001b3ULL;
+        }
+        if (!table_.record(trace, hash == 0 ? 1 : hash)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Prints the most frequent stacks, symbolizing anything still pending.
+    void report(std::ostream& os, std::size_t top) {
+        symbolize_pending();
+        std::vector<std::pair<std::uint64_t, std::size_t>> by_hits;
+        for (std::size_t i = 0; i < stack_table::capacity; ++i) {
+            if (table_[i].ready.load(std::memory_order_acquire)) {
+                by_hits.emplace_back(table_[i].hits.load(std::memory_order_relaxed), i);
+            }
+        }
+        std::sort(by_hits.rbegin(), by_hits.rend());
+        os << by_hits.size() << " distinct stacks, " << dropped_.load() << " dropped" << std::endl;
+        std::lock_guard lock{symbols_mx_};
+        for (std::size_t i = 0; i < std::min(top, by_hits.size()); ++i) {
+            os << by_hits[i].first << " samples:\n" << symbols_[by_hits[i].second];
+        }
+    }
+
+private:
+    void symbolize_pending() {
+        for (std::size_t i = 0; i < stack_table::capacity; ++i) {
+            stack_table::slot& s = table_[i];
+            if (!s.ready.load(std::memory_order_acquire)) {
+                continue;
+            }
+            {
+                std::lock_guard lock{symbols_mx_};
+                if (!symbols_[i].empty()) {
+                    continue;
+                }
+            }
+            std::string text;
+            for (std::size_t f = 0; f < s.depth; ++f) {
+                text += "  " + s.frames[f].description();
+                if (!s.frames[f].source_file().empty()) {
+                    text += " at " + s.frames[f].source_file() + ":" + std::to_string(s.frames[f].source_line());
+                }
+                text += '\n';
+            }
+            std::lock_guard lock{symbols_mx_};
+            symbols_[i] = std::move(text);
+        }
+    }
+
+    stack_table table_;
+    std::atomic<std::uint64_t> dropped_{0};
+    std::mutex symbols_mx_;
+    std::vector<std::string> symbols_;
+    std::jthread symbolizer_;
+};
+
+stack_sampler sampler{std::chrono::milliseconds(100)};
+
+[[gnu::noinline]] void allocate_buffer(int i) {
+    sampler.sample();
+    asm volatile("" ::"r"(i));
+}
+
+[[gnu::noinline]] void parse_request(int i) {
+    if (i % 3 == 0) {
+        allocate_buffer(i);
+    } else {
+        sampler.sample();
+    }
+    asm volatile("" ::"r"(i));
+}
+
+[[gnu::noinline]] void handle_request(int i) {
+    parse_request(i);
+    asm volatile("" ::"r"(i));
+}
+
+template <typename F>
+double ns_per_call(int iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int samples = argc > 1 ? std::stoi(argv[1]) : 1'000'000;
+
+    std::cout << "sampled capture          " << ns_per_call(samples, handle_request) << " ns" << std::endl;
+    std::cout << "std::stacktrace::current " << ns_per_call(samples / 10, [](int) {
+        auto trace = std::stacktrace::current();
+        asm volatile("" ::"r"(trace.size()));
+    }) << " ns" << std::endl;
+    std::cout << "current() + to_string    " << ns_per_call(100, [](int) {
+        auto text = std::to_string(std::stacktrace::current());
+        asm volatile("" ::"r"(text.size()));
+    }) << " ns" << std::endl;
+
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([samples] {
+            for (int i = 0; i < samples; ++i) {
+                handle_request(i);
+            }
+        });
+    }
+    threads.clear();
+
+    sampler.report(std::cout, 3);
+    return 0;
+}
@@ -0,0 +1,165 @@
+// Stateless function objects with C++23 static operator() and operator[].
+// A static call operator has no implicit object parameter, so when the call is
+// not inlined (large comparator, type-erased or function-pointer call sites)
+// the caller does not have to materialize and pass `this`.
+// Build: g++ -std=c++23 -O2 static_call_operator.cpp
+// Usage: ./a.out [elements]   (default 5'000'000)
+// Codegen: g++ -std=c++23 -O2 -S -o - static_call_operator.cpp | c++filt
+//          and compare the calls into member_less::operator() with
+//          static_less::operator() inside std::sort: the member version
+//          passes the comparator's address in %rdi, shifting the arguments.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#if __has_include(<flat_map>)
+#include <flat_map>
+#endif
+
+// Comparators
+
+struct less {
+    static constexpr bool operator()(const auto& a, const auto& b) { return a < b; }
+};
+
+struct greater {
+    static constexpr bool operator()(const auto& a, const auto& b) { return b < a; }
+};
+
+// Orders by a data member or member function, e.g. by<&order::price>.
+template <auto Member>
+struct by {
+    static constexpr bool operator()(const auto& a, const auto& b) {
+        return std::invoke(Member, a) < std::invoke(Member, b);
+    }
+};
+
+// Projections
+
+template <auto Member>
+struct project {
+    static constexpr decltype(auto) operator()(const auto& x) { return std::invoke(Member, x); }
+};
+
+// Hashers
+
+struct mix_hash {
+    static constexpr std::size_t operator()(std::uint64_t x) noexcept {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+// Transparent, so an unordered_map<std::string, T> can be probed with a
+// string_view without building a std::string.
+struct string_hash {
+    using is_transparent = void;
+    static constexpr std::size_t operator()(std::string_view s) noexcept {
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (char c : s) {
+            h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+        return h;
+    }
+};
+
+struct string_equal {
+    using is_transparent = void;
+    static constexpr bool operator()(std::string_view a, std::string_view b) noexcept { return a == b; }
+};
+
+// Lookup tables
+
+struct hex_digit {
+    static constexpr int operator[](char c) {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+    }
+};
+
+// The same comparison with a non-static and a static call operator. noinline
+// stands in for a comparator too big to inline, which is where the implicit
+// object parameter shows up in the generated code.
+struct member_less {
+    [[gnu::noinline]] bool operator()(std::uint64_t a, std::uint64_t b) const { return mix_hash{}(a) < mix_hash{}(b); }
+};
+
+struct static_less {
+    [[gnu::noinline]] static bool operator()(std::uint64_t a, std::uint64_t b) { return mix_hash{}(a) < mix_hash{}(b); }
+};
+
+struct order {
+    std::uint64_t id;
+    double price;
+};
+
+template <typename F>
+double milliseconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::stoull(argv[1]) : 5'000'000;
+
+    std::cout << "hex_digit['b'] = " << hex_digit{}['b'] << ", less(1, 2) = " << less::operator()(1, 2) << std::endl;
+
+    std::mt19937_64 gen(42);
+    std::vector<std::uint64_t> keys(n);
+    for (auto& k : keys) {
+        k = gen();
+    }
+
+    auto copy = keys;
+    double member_ms = milliseconds([&] { std::sort(copy.begin(), copy.end(), member_less{}); });
+    copy = keys;
+    double static_ms = milliseconds([&] { std::sort(copy.begin(), copy.end(), static_less{}); });
+    copy = keys;
+    double ranges_ms = milliseconds([&] { std::ranges::sort(copy, static_less{}); });
+    std::cout << "std::sort, member operator()   " << member_ms << " ms" << std::endl;
+    std::cout << "std::sort, static operator()   " << static_ms << " ms" << std::endl;
+    std::cout << "ranges::sort, static operator() " << ranges_ms << " ms" << std::endl;
+
+    std::vector<order> orders(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        orders[i] = {keys[i], static_cast<double>(keys[i] % 100000) / 100};
+    }
+    double by_ms = milliseconds([&] { std::sort(orders.begin(), orders.end(), by<&order::price>{}); });
+    double proj_ms = milliseconds([&] { std::ranges::sort(orders, greater{}, project<&order::id>{}); });
+    std::cout << "sort by<&order::price>          " << by_ms << " ms" << std::endl;
+    std::cout << "ranges::sort project<&order::id> " << proj_ms << " ms" << std::endl;
+
+    std::unordered_map<std::uint64_t, std::uint32_t, mix_hash> ids;
+    std::unordered_map<std::string, int, string_hash, string_equal> names;
+    names.emplace("alice", 30);
+    for (std::size_t i = 0; i < std::min<std::size_t>(n, 1'000'000); ++i) {
+        ids.emplace(keys[i], static_cast<std::uint32_t>(i));
+    }
+    std::uint64_t found = 0;
+    double hash_ms = milliseconds([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            found += ids.count(keys[i]);
+        }
+    });
+    std::cout << "unordered_map<.., mix_hash> " << hash_ms * 1e6 / n << " ns/lookup (" << found << " hits)" << std::endl;
+#if __has_include(<flat_map>)
+    std::flat_map<std::uint64_t, std::uint32_t, greater> newest_first;
+    for (std::size_t i = 0; i < 5; ++i) {
+        newest_first.emplace(keys[i] % 1000, static_cast<std::uint32_t>(i));
+    }
+    std::cout << "flat_map<.., greater> front key " << newest_first.begin()->first << std::endl;
+#endif
+    std::cout << "names.find(string_view) -> " << names.find(std::string_view("alice"))->second << std::endl;
+    return 0;
+}
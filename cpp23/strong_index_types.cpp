@@ -0,0 +1,252 @@
+// Strong index types over std::size_t. idx<Tag> cannot be mixed with a plain
+// int or with another tag's index, is bounds-checked in debug builds and
+// compiles to a bare size_t in release builds (-DNDEBUG), so its loops
+// vectorize exactly like hand-written size_t loops.
+//
+// Build:  g++ -std=c++23 -O3 -DNDEBUG strong_index_types.cpp
+// Debug:  g++ -std=c++23 -O0 strong_index_types.cpp   (checked indexing)
+// Usage:  ./a.out [elements]   (default 1'000'000)
+//
+// Vectorizer report, one line per loop that vectorized:
+//     g++ -std=c++23 -O3 -DNDEBUG -fopt-info-vec-optimized -c strong_index_types.cpp
+// and the reasons for the ones that did not:
+//     g++ -std=c++23 -O3 -DNDEBUG -fopt-info-vec-missed -c strong_index_types.cpp 2>&1 | grep strong_index
+// With GCC 12 the int, size_t and idx<Tag> loops all vectorize; the three
+// 32-bit unsigned loops do not. Unsigned wraparound is defined, so x[i + offset]
+// may jump back to x[0] and the accesses are not one contiguous range; signed
+// overflow is undefined, which lets the compiler widen an int induction
+// variable once outside the loop. At -O2, GCC 12's very-cheap cost model
+// declines all of these loops, since each needs a runtime alias check or a
+// scalar epilogue.
+#include <chrono>
+#include <compare>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+template <typename Tag>
+class idx {
+public:
+    constexpr idx() = default;
+    constexpr explicit idx(std::size_t value) : value_(value) {}
+
+    constexpr std::size_t get() const { return value_; }
+
+    constexpr idx& operator++() {
+        ++value_;
+        return *this;
+    }
+    constexpr idx& operator--() {
+        --value_;
+        return *this;
+    }
+    constexpr idx& operator+=(std::size_t n) {
+        value_ += n;
+        return *this;
+    }
+    friend constexpr idx operator+(idx i, std::size_t n) { return idx{i.value_ + n}; }
+    friend constexpr idx operator-(idx i, std::size_t n) { return idx{i.value_ - n}; }
+    friend constexpr std::size_t operator-(idx a, idx b) { return a.value_ - b.value_; }
+    friend constexpr auto operator<=>(idx, idx) = default;
+
+private:
+    std::size_t value_ = 0;
+};
+
+// 3_ix converts to any idx<Tag>, the way 3uz converts to any size_t context.
+struct index_literal {
+    std::size_t value;
+    template <typename Tag>
+    constexpr operator idx<Tag>() const {
+        return idx<Tag>{value};
+    }
+};
+
+consteval index_literal operator""_ix(unsigned long long value) { return {static_cast<std::size_t>(value)}; }
+
+// A std::vector that can only be indexed with its own tag.
+template <typename T, typename Tag>
+class tagged_vector {
+public:
+    using index = idx<Tag>;
+
+    tagged_vector() = default;
+    explicit tagged_vector(std::size_t n, const T& value = T()) : data_(n, value) {}
+
+    T& operator[](index i) {
+        check(i);
+        return data_[i.get()];
+    }
+    const T& operator[](index i) const {
+        check(i);
+        return data_[i.get()];
+    }
+
+    // One past the last index, for `for (index i = 0_ix; i < v.extent(); ++i)`.
+    index extent() const { return index{data_.size()}; }
+    std::size_t size() const { return data_.size(); }
+    T* data() { return data_.data(); }
+
+private:
+    void check([[maybe_unused]] index i) const {
+#ifndef NDEBUG
+        if (i.get() >= data_.size()) {
+            std::fprintf(stderr, "index %zu out of range for size %zu\n", i.get(), data_.size());
+            std::abort();
+        }
+#endif
+    }
+
+    std::vector<T> data_;
+};
+
+struct sample_tag {};
+struct channel_tag {};
+using sample = idx<sample_tag>;
+using channel = idx<channel_tag>;
+
+// The same three kernels with four kinds of induction variable. noinline keeps
+// each one a separate loop in the vectorizer report.
+
+// y[i + offset] += a * x[i + offset]
+[[gnu::noinline]] void axpy_int(float a, const float* x, float* y, int n, int offset) {
+    for (int i = 0; i < n; ++i) {
+        y[i + offset] += a * x[i + offset];
+    }
+}
+
+[[gnu::noinline]] void axpy_unsigned(float a, const float* x, float* y, unsigned n, unsigned offset) {
+    for (unsigned i = 0; i < n; ++i) {
+        y[i + offset] += a * x[i + offset];
+    }
+}
+
+[[gnu::noinline]] void axpy_size_t(float a, const float* x, float* y, std::size_t n, std::size_t offset) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i + offset] += a * x[i + offset];
+    }
+}
+
+[[gnu::noinline]] void axpy_idx(float a, const tagged_vector<float, sample_tag>& x, tagged_vector<float, sample_tag>& y,
+                                sample begin, sample end) {
+    for (sample i = begin; i < end; ++i) {
+        y[i] += a * x[i];
+    }
+}
+
+// Every other element: x[2 * i]
+[[gnu::noinline]] float strided_sum_int(const float* x, int n) {
+    float sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += x[2 * i];
+    }
+    return sum;
+}
+
+[[gnu::noinline]] float strided_sum_unsigned(const float* x, unsigned n) {
+    float sum = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        sum += x[2 * i];
+    }
+    return sum;
+}
+
+[[gnu::noinline]] float strided_sum_size_t(const float* x, std::size_t n) {
+    float sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += x[2 * i];
+    }
+    return sum;
+}
+
+[[gnu::noinline]] float strided_sum_idx(const tagged_vector<float, sample_tag>& x, sample n) {
+    float sum = 0;
+    for (sample i = 0_ix; i < n; ++i) {
+        sum += x[sample{2 * i.get()}];
+    }
+    return sum;
+}
+
+// Interleaved channels: out[c][i] = in[i * channels + c]
+[[gnu::noinline]] void deinterleave_int(const float* in, float* left, float* right, int frames) {
+    for (int i = 0; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+[[gnu::noinline]] void deinterleave_unsigned(const float* in, float* left, float* right, unsigned frames) {
+    for (unsigned i = 0; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+[[gnu::noinline]] void deinterleave_size_t(const float* in, float* left, float* right, std::size_t frames) {
+    for (std::size_t i = 0; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+[[gnu::noinline]] void deinterleave_idx(const tagged_vector<float, sample_tag>& in,
+                                        tagged_vector<tagged_vector<float, sample_tag>, channel_tag>& out) {
+    tagged_vector<float, sample_tag>& left = out[0_ix];
+    tagged_vector<float, sample_tag>& right = out[1_ix];
+    for (sample i = 0_ix; i < left.extent(); ++i) {
+        left[i] = in[sample{2 * i.get()}];
+        right[i] = in[sample{2 * i.get() + 1}];
+    }
+}
+
+volatile float benchmark_sink;
+
+template <typename F>
+void run(const char* name, std::size_t elements, int repeats, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        f();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << name << ns / (static_cast<double>(elements) * repeats) << " ns/element" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    const int repeats = 200;
+    const std::size_t offset = 16uz;
+
+    tagged_vector<float, sample_tag> x(2 * n + offset, 1.0f), y(2 * n + offset, 2.0f);
+    tagged_vector<tagged_vector<float, sample_tag>, channel_tag> channels(2, tagged_vector<float, sample_tag>(n));
+    // x[3] = 0.0f;       // error: no conversion from int to sample
+    // channels[sample{0}] // error: sample is not a channel index
+    x[3_ix] = 0.5f;
+
+    std::cout << "axpy, y[i + offset] += a * x[i + offset]" << std::endl;
+    run("int        ", n, repeats, [&] { axpy_int(0.5f, x.data(), y.data(), static_cast<int>(n), static_cast<int>(offset)); });
+    run("unsigned   ", n, repeats, [&] {
+        axpy_unsigned(0.5f, x.data(), y.data(), static_cast<unsigned>(n), static_cast<unsigned>(offset));
+    });
+    run("size_t     ", n, repeats, [&] { axpy_size_t(0.5f, x.data(), y.data(), n, offset); });
+    run("idx<Tag>   ", n, repeats, [&] { axpy_idx(0.5f, x, y, sample{offset}, sample{offset + n}); });
+
+    std::cout << "strided sum, x[2 * i]" << std::endl;
+    run("int        ", n, repeats, [&] { benchmark_sink = strided_sum_int(x.data(), static_cast<int>(n)); });
+    run("unsigned   ", n, repeats, [&] { benchmark_sink = strided_sum_unsigned(x.data(), static_cast<unsigned>(n)); });
+    run("size_t     ", n, repeats, [&] { benchmark_sink = strided_sum_size_t(x.data(), n); });
+    run("idx<Tag>   ", n, repeats, [&] { benchmark_sink = strided_sum_idx(x, sample{n}); });
+
+    std::cout << "deinterleave stereo" << std::endl;
+    float* left = channels[0_ix].data();
+    float* right = channels[1_ix].data();
+    run("int        ", n, repeats, [&] { deinterleave_int(x.data(), left, right, static_cast<int>(n)); });
+    run("unsigned   ", n, repeats, [&] { deinterleave_unsigned(x.data(), left, right, static_cast<unsigned>(n)); });
+    run("size_t     ", n, repeats, [&] { deinterleave_size_t(x.data(), left, right, n); });
+    run("idx<Tag>   ", n, repeats, [&] { deinterleave_idx(x, channels); });
+
+    benchmark_sink = y[sample{offset}] + left[0] + right[0];
+    return 0;
+}